@@ -2,6 +2,10 @@
 #include <WindowListener.h>
 #include <Graphic.h>
 #include <Utils.h>
+#include <ShaderCache.h>
+#include <ShaderProgram.h>
+#include <GlStateCache.h>
+#include <GpuBuffer.h>
 #include <string>
 #include <cassert>
 
@@ -10,6 +14,9 @@ class App : public WindowListener
 private:
 	Graphic& m_graphic;
 	int m_width, m_height;
+	GpuBuffer m_positionBuffer;
+	ShaderProgram m_program;
+	GlStateCache m_state;
 
 public:
 	App(Graphic& graphic, int width, int height) : m_graphic(graphic), m_width(width), m_height(height)
@@ -20,8 +27,6 @@ public:
 		{\
 			gl_Position = vec4(a_position, 0.0, 1.0);\
 		}";
-		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
-		assert(vs > 0);
 
 		const std::string fsSource = "\
 		precision mediump float;\
@@ -29,12 +34,14 @@ public:
 		{\
 			gl_FragColor = vec4(1.0, 0.0, 1.0, 1.0);\
 		}";
-		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
-		assert(fs > 0);
 
-		auto program = Utils::linkProgram(vs, fs);
+		// Later launches load the linked program from disk
+		ShaderCache shaderCache;
+		auto program = shaderCache.load(vsSource, fsSource);
 		assert(program > 0);
-		glUseProgram(program);
+		printf("Program %s in %.2f ms\n", shaderCache.lastHit() ? "loaded from cache" : "compiled", shaderCache.lastMs());
+		m_program.reset(program);
+		m_program.use();
 
 		static float positions[] =
 		{
@@ -42,9 +49,10 @@ public:
 			-1.0f,-1.0f,
 			1.0f,-1.0f
 		};
-		auto positionLocation = glGetAttribLocation(program, "a_position");
+		auto positionLocation = m_program.attribute(ShaderProgram::hash("a_position"));
 		assert(positionLocation >= 0);
-		glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, positions);
+		m_positionBuffer.upload(GL_ARRAY_BUFFER, positions, sizeof(positions));
+		glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(positionLocation);
 
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -75,7 +83,7 @@ private:
 	void reder()
 	{
 		glClear(GL_COLOR_BUFFER_BIT);
-		glViewport(0, 0, m_width, m_height);
+		m_state.viewport(0, 0, m_width, m_height);
 		glDrawArrays(GL_TRIANGLES, 0, 3);
 
 		m_graphic.swapBuffers();
@@ -1,25 +1,28 @@
 #include <stdio.h>
-#include <Windows.h>
 #include <Window.h>
 #include <Graphic.h>
 #include <Utils.h>
 #include "App.h"
 
+#ifdef _WIN32
 int WINAPI WinMain(
 	_In_ HINSTANCE hInstance,
 	_In_opt_ HINSTANCE hPrevInstance,
 	_In_ LPSTR lpCmdLine,
 	_In_ int nShowCmd)
+#else
+int main()
+#endif
 {
 	Utils::showConsole();
 
 	const int WIDTH = 800, HEIGHT = 480;
 	const bool RESIZABLE = true;
-	Window window(hInstance, WIDTH, HEIGHT, RESIZABLE, "Hello Triangle");
+	auto window = Window::create(WIDTH, HEIGHT, RESIZABLE, "Hello Triangle");
 
-	Graphic graphic(window.surface());
+	Graphic graphic(*window);
 	App app(graphic, WIDTH, HEIGHT);
 
-	window.show(30, &app, nShowCmd);
+	window->show(30, &app);
 	return 0;
 }
@@ -2,15 +2,23 @@
 #include <WindowListener.h>
 #include <Graphic.h>
 #include <Utils.h>
+#include <ShaderCache.h>
+#include <ShaderProgram.h>
+#include <GlStateCache.h>
+#include <GpuBuffer.h>
 #include <string>
 #include <cassert>
+#include <math.h>
 
 class App : public WindowListener
 {
 private:
 	Graphic& m_graphic;
 	int m_width, m_height;
-	GLint m_matrixLocation;
+	GpuBuffer m_positionBuffer, m_colorBuffer;
+	ShaderProgram m_program;
+	GlStateCache m_state;
+	int m_matrixUniform;
 	float m_angle = 0.0;
 
 public:
@@ -26,8 +34,6 @@ public:
 			gl_Position = u_matrix * vec4(a_position, 0.0, 1.0);\
 			v_color = a_color;\
 		}";
-		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
-		assert(vs > 0);
 
 		const std::string fsSource = "\
 		precision mediump float;\
@@ -36,12 +42,14 @@ public:
 		{\
 			gl_FragColor = vec4(v_color, 1.0);\
 		}";
-		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
-		assert(fs > 0);
 
-		auto program = Utils::linkProgram(vs, fs);
+		// Later launches load the linked program from disk
+		ShaderCache shaderCache;
+		auto program = shaderCache.load(vsSource, fsSource);
 		assert(program > 0);
-		glUseProgram(program);
+		printf("Program %s in %.2f ms\n", shaderCache.lastHit() ? "loaded from cache" : "compiled", shaderCache.lastMs());
+		m_program.reset(program);
+		m_program.use();
 
 		static float positions[] =
 		{
@@ -49,9 +57,10 @@ public:
 			-1.0f,-1.0f,
 			1.0f,-1.0f
 		};
-		auto positionLocation = glGetAttribLocation(program, "a_position");
+		auto positionLocation = m_program.attribute(ShaderProgram::hash("a_position"));
 		assert(positionLocation >= 0);
-		glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, positions);
+		m_positionBuffer.upload(GL_ARRAY_BUFFER, positions, sizeof(positions));
+		glVertexAttribPointer(positionLocation, 2, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(positionLocation);
 
 		static GLubyte colors[] =
@@ -60,15 +69,16 @@ public:
 			0,255,0,
 			0,0,255
 		};
-		auto colorLocation = glGetAttribLocation(program, "a_color");
+		auto colorLocation = m_program.attribute(ShaderProgram::hash("a_color"));
 		assert(colorLocation >= 0);
-		glVertexAttribPointer(colorLocation, 3, GL_UNSIGNED_BYTE, GL_TRUE, 0, colors);
+		m_colorBuffer.upload(GL_ARRAY_BUFFER, colors, sizeof(colors));
+		glVertexAttribPointer(colorLocation, 3, GL_UNSIGNED_BYTE, GL_TRUE, 0, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(colorLocation);
 
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-		m_matrixLocation = glGetUniformLocation(program, "u_matrix");
-		assert(m_matrixLocation >= 0);
+		m_matrixUniform = m_program.uniform(ShaderProgram::hash("u_matrix"));
+		assert(m_matrixUniform >= 0);
 	}
 
 	bool tick()
@@ -109,9 +119,9 @@ private:
 		};
 
 		glClear(GL_COLOR_BUFFER_BIT);
-		glViewport(0, 0, m_width, m_height);
+		m_state.viewport(0, 0, m_width, m_height);
 
-		glUniformMatrix4fv(m_matrixLocation, 1, GL_FALSE, rotation);
+		m_program.set(m_matrixUniform, rotation);
 
 		glDrawArrays(GL_TRIANGLES, 0, 3);
 
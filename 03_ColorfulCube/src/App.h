@@ -2,17 +2,25 @@
 #include <WindowListener.h>
 #include <Graphic.h>
 #include <Utils.h>
+#include <ShaderCache.h>
+#include <ShaderProgram.h>
+#include <GlStateCache.h>
 #include <string>
 #include <cassert>
 #include <glmath.h>
+#include <GpuBuffer.h>
 
 class App : public WindowListener
 {
 private:
 	Graphic& m_graphic;
 	int m_width, m_height;
-	int m_matrixLocation;
-	Matrix m_rotationMatrix;
+	ShaderProgram m_program;
+	GlStateCache m_state;
+	int m_matrixUniform;
+	GpuBuffer m_positionBuffer, m_colorBuffer, m_indexBuffer;
+	Quaternion m_rotation;
+	Quaternion m_spin;
 	float m_distance;
 	bool m_exit;
 	bool m_moving;
@@ -21,7 +29,8 @@ private:
 
 public:
 	App(Graphic& graphic, int width, int height) : m_graphic(graphic), m_width(width), m_height(height),
-													m_rotationMatrix(Matrix::identity())
+													m_rotation(Quaternion::identity()),
+													m_spin(Quaternion::identity())
 	{
 		const std::string vsSource = "\
 		attribute vec3 a_position;\
@@ -33,8 +42,6 @@ public:
 			gl_Position = u_matrix * vec4(a_position, 1.0);\
 			v_color = a_color;\
 		}";
-		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
-		assert(vs > 0);
 
 		const std::string fsSource = "\
 		precision mediump float;\
@@ -43,12 +50,14 @@ public:
 		{\
 			gl_FragColor = vec4(v_color, 1.0);\
 		}";
-		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
-		assert(fs > 0);
 
-		auto program = Utils::linkProgram(vs, fs);
+		// Later launches load the linked program from disk
+		ShaderCache shaderCache;
+		auto program = shaderCache.load(vsSource, fsSource);
 		assert(program > 0);
-		glUseProgram(program);
+		printf("Program %s in %.2f ms\n", shaderCache.lastHit() ? "loaded from cache" : "compiled", shaderCache.lastMs());
+		m_program.reset(program);
+		m_program.use();
 
 		//
 		static float positions[] =
@@ -63,8 +72,9 @@ public:
 			 1.0f, -1.0f, -1.0f,
 			 1.0f,  1.0f, -1.0f
 		};
-		auto positionLocation = glGetAttribLocation(program, "a_position");
-		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, positions);
+		auto positionLocation = m_program.attribute(ShaderProgram::hash("a_position"));
+		m_positionBuffer.upload(GL_ARRAY_BUFFER, positions, sizeof(positions));
+		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(positionLocation);
 
 		//
@@ -80,14 +90,27 @@ public:
 			255, 255, 255
 
 		};
-		auto colorLocation = glGetAttribLocation(program, "a_color");
+		auto colorLocation = m_program.attribute(ShaderProgram::hash("a_color"));
 		assert(colorLocation >= 0);
-		glVertexAttribPointer(colorLocation, 3, GL_UNSIGNED_BYTE, GL_TRUE, 0, colors);
+		m_colorBuffer.upload(GL_ARRAY_BUFFER, colors, sizeof(colors));
+		glVertexAttribPointer(colorLocation, 3, GL_UNSIGNED_BYTE, GL_TRUE, 0, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(colorLocation);
 
 		//
-		m_matrixLocation = glGetUniformLocation(program, "u_matrix");
-		assert(m_matrixLocation >= 0);
+		static const GLbyte indices[] =
+		{
+			0 , 1, 2, 0, 2, 3,  // float
+			4 , 6, 5, 4, 7, 6,  // back
+			0 , 5, 1, 0, 4, 5,  // left
+			3 , 2, 6, 3, 6, 7,  // right
+			0 , 3, 4, 4, 3, 7,  // top
+			1 , 6, 2, 1, 5, 6,  // bottom
+		};
+		m_indexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, indices, sizeof(indices));
+
+		//
+		m_matrixUniform = m_program.uniform(ShaderProgram::hash("u_matrix"));
+		assert(m_matrixUniform >= 0);
 
 		//
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -96,6 +119,10 @@ public:
 		//
 		m_distance = 0.0f;
 		m_exit = false;
+		m_spin =
+			Quaternion::rotation(-rotationStep, 0.0f, 0.0f, 1.0f)
+			* Quaternion::rotation(-rotationStep, 0.0f, 1.0f, 0.0f)
+			* Quaternion::rotation(-rotationStep, 1.0f, 0.0f, 0.0f);
 		m_moving = false;
 		m_isgoingfar = true;
 	}
@@ -117,33 +144,33 @@ public:
 		const float distanceStep = 0.1f;
 		switch (keycode)
 		{
-		case VK_DOWN:
-			m_rotationMatrix = Matrix::rotation(rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
+		case KEY_DOWN:
+			m_rotation = (Quaternion::rotation(rotationStep, 1.0f, 0.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_UP:
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
+		case KEY_UP:
+			m_rotation = (Quaternion::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_LEFT:
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
+		case KEY_LEFT:
+			m_rotation = (Quaternion::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_RIGHT:
-			m_rotationMatrix = Matrix::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
+		case KEY_RIGHT:
+			m_rotation = (Quaternion::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_SPACE:
-			m_rotationMatrix = Matrix::identity();
+		case KEY_SPACE:
+			m_rotation = Quaternion::identity();
 			m_distance = 0.0f;
 			break;
-		case VK_RETURN:
+		case KEY_ENTER:
 			m_distance += distanceStep;
 			break;
-		case VK_BACK:
+		case KEY_BACKSPACE:
 			m_distance -= distanceStep;
 			break;
-		case VK_TAB:
+		case KEY_TAB:
 			m_moving = !m_moving;
 			break;
 
-		case VK_ESCAPE:
+		case KEY_ESCAPE:
 			m_exit = true;
 			break;
 		}
@@ -156,9 +183,7 @@ private:
 		if (m_moving)
 		{
 
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 0.0f, 1.0f) * m_rotationMatrix;
+			m_rotation = (m_spin * m_rotation).normalized();
 
 			if (m_isgoingfar)
 			{
@@ -186,7 +211,7 @@ private:
 	void reder()
 	{
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, m_width, m_height);
+		m_state.viewport(0, 0, m_width, m_height);
 
 		const float h = 1.0f;
 		const float w = h * m_width/m_height;
@@ -194,19 +219,10 @@ private:
 		const Matrix matrix =
 			Matrix::frustum(-w / 2, w / 2, -h / 2, h / 2, 1.0f, 50.0f)
 			* Matrix::translate(0.0f, 0.0f, -4.0f + m_distance)
-			* m_rotationMatrix;
-		glUniformMatrix4fv(m_matrixLocation, 1, GL_FALSE, matrix.data());
+			* Matrix::rotation(m_rotation);
+		m_program.set(m_matrixUniform, matrix.data());
 
-		const GLbyte indices[] =
-		{
-			0 , 1, 2, 0, 2, 3,  // float
-			4 , 6, 5, 4, 7, 6,  // back
-			0 , 5, 1, 0, 4, 5,  // left
-			3 , 2, 6, 3, 6, 7,  // right
-			0 , 3, 4, 4, 3, 7,  // top
-			1 , 6, 2, 1, 5, 6,  // bottom
-		};
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, indices);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, GpuBuffer::offset(0));
 
 		m_graphic.swapBuffers();
 	}
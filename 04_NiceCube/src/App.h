@@ -3,38 +3,56 @@
 #include <WindowListener.h>
 #include <Graphic.h>
 #include <Utils.h>
+#include <ShaderCache.h>
+#include <ShaderProgram.h>
+#include <GlStateCache.h>
 #include <string>
 #include <cassert>
 #include <glmath.h>
 #include <Tga.h>
+#include <Texture.h>
+#include <GpuBuffer.h>
+#include <FramePacer.h>
 
 class App : public WindowListener
 {
 private:
 	Graphic& m_graphic;
 	int m_width, m_height;
-	int m_matrixLocation;
-	Matrix m_rotationMatrix;
+	ShaderProgram m_program;
+	GlStateCache m_state;
+	int m_matrixUniform;
+	GpuBuffer m_positionBuffer, m_texCoordBuffer, m_indexBuffer;
+	Quaternion m_rotation;
+	Quaternion m_spin;
 	float m_distance;
+
+	// The cube moves in fixed 1/30 s steps whatever the frame rate; frames in
+	// between interpolate from the previous step's state.
+	FixedTimestep m_timestep;
+	Quaternion m_previousRotation;
+	float m_previousDistance;
 	bool m_exit;
 	bool m_moving;
 	bool m_isgoingfar;
 
 public:
 	App(Graphic& graphic, int width, int height) : m_graphic(graphic), m_width(width), m_height(height),
-		m_rotationMatrix(Matrix::identity())
+		m_rotation(Quaternion::identity()),
+		m_spin(Quaternion::identity()),
+		m_timestep(30),
+		m_previousRotation(Quaternion::identity())
 	{
 		auto vsSource = Utils::readFile("vs.glsl");
-		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
-		assert(vs > 0);
-
 		auto fsSource = Utils::readFile("fs.glsl");
-		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
-		assert(fs > 0);
 
-		auto program = Utils::linkProgram(vs, fs);
+		// Later launches load the linked program from disk
+		ShaderCache shaderCache;
+		auto program = shaderCache.load(vsSource, fsSource);
 		assert(program > 0);
-		glUseProgram(program);
+		printf("Program %s in %.2f ms\n", shaderCache.lastHit() ? "loaded from cache" : "compiled", shaderCache.lastMs());
+		m_program.reset(program);
+		m_program.use();
 
 		//
 #define A -1.0f, -1.0f, 1.0f
@@ -56,8 +74,9 @@ public:
 			D, C, H, G, //top
 			F, E, B, A, // bottom
 		};
-		auto positionLocation = glGetAttribLocation(program, "a_position");
-		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, position);
+		auto positionLocation = m_program.attribute(ShaderProgram::hash("a_position"));
+		m_positionBuffer.upload(GL_ARRAY_BUFFER, position, sizeof(position));
+		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(positionLocation);
 
 		//
@@ -77,29 +96,38 @@ public:
 			FACE_TEX_COORDS
 		};
 
-		auto texCoordLocation = glGetAttribLocation(program, "a_texCoord");
+		auto texCoordLocation = m_program.attribute(ShaderProgram::hash("a_texCoord"));
 		assert(texCoordLocation >= 0);
-		glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, 0, texCoords);
+		m_texCoordBuffer.upload(GL_ARRAY_BUFFER, texCoords, sizeof(texCoords));
+		glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(texCoordLocation);
 
 		//
-		m_matrixLocation = glGetUniformLocation(program, "u_matrix");
-		assert(m_matrixLocation >= 0);
+		static const GLubyte indices[] =
+		{
+			0, 1, 2, 0, 2, 3, //front
+			4, 5, 6, 4, 6, 7, // back
+			8, 9, 10, 8, 10, 11, //left
+			12, 13, 14, 12, 14, 15, //right
+			16, 17, 18, 16, 18, 19, //top
+			20, 21, 22, 20, 22, 23, //bottom
+		};
+		m_indexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, indices, sizeof(indices));
+
+		//
+		m_matrixUniform = m_program.uniform(ShaderProgram::hash("u_matrix"));
+		assert(m_matrixUniform >= 0);
 
 		//
 		GLuint texture;
 		glGenTextures(1, &texture);
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		auto tga = Tga("cat.tga");
 		assert(tga.okay());
-		auto format = tga.hasAlpha() ? GL_RGBA : GL_RGB;
-		glTexImage2D(GL_TEXTURE_2D, 0, format, tga.width(), tga.height(), 0, format, GL_UNSIGNED_BYTE, tga.data());
-		auto samplerLocation = glGetUniformLocation(program, "u_sampler");
-		assert(samplerLocation >= 0);
-		glUniform1i(samplerLocation, 0);
+		Texture::upload(texture, tga.width(), tga.height(), tga.hasAlpha(), tga.data(), Texture::Mipmap);
+		auto samplerUniform = m_program.uniform(ShaderProgram::hash("u_sampler"));
+		assert(samplerUniform >= 0);
+		m_program.set(samplerUniform, 0);
 
 		//
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -107,7 +135,12 @@ public:
 
 		//
 		m_distance = 0.0f;
+		m_previousDistance = 0.0f;
 		m_exit = false;
+		m_spin =
+			Quaternion::rotation(-rotationStep, 0.0f, 0.0f, 1.0f)
+			* Quaternion::rotation(-rotationStep, 0.0f, 1.0f, 0.0f)
+			* Quaternion::rotation(-rotationStep, 1.0f, 0.0f, 0.0f);
 		m_moving = false;
 		m_isgoingfar = true;
 
@@ -115,8 +148,12 @@ public:
 	}
 	bool tick()
 	{
-		render();
-		return update();
+		for (auto steps = m_timestep.advance(); steps > 0; --steps)
+		{
+			if (!update()) return false;
+		}
+		render(m_timestep.alpha());
+		return !m_exit;
 	}
 	void onResixed(int newWidth, int newHeigth)
 	{
@@ -129,33 +166,33 @@ public:
 		const float distanceStep = 0.1f;
 		switch (keycode)
 		{
-		case VK_DOWN:
-			m_rotationMatrix = Matrix::rotation(rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
+		case KEY_DOWN:
+			m_rotation = (Quaternion::rotation(rotationStep, 1.0f, 0.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_UP:
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
+		case KEY_UP:
+			m_rotation = (Quaternion::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_LEFT:
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
+		case KEY_LEFT:
+			m_rotation = (Quaternion::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_RIGHT:
-			m_rotationMatrix = Matrix::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
+		case KEY_RIGHT:
+			m_rotation = (Quaternion::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_SPACE:
-			m_rotationMatrix = Matrix::identity();
+		case KEY_SPACE:
+			m_rotation = Quaternion::identity();
 			m_distance = 0.0f;
 			break;
-		case VK_RETURN:
+		case KEY_ENTER:
 			m_distance += distanceStep;
 			break;
-		case VK_BACK:
+		case KEY_BACKSPACE:
 			m_distance -= distanceStep;
 			break;
-		case VK_TAB:
+		case KEY_TAB:
 			m_moving = !m_moving;
 			break;
 
-		case VK_ESCAPE:
+		case KEY_ESCAPE:
 			m_exit = true;
 			break;
 		}
@@ -166,12 +203,12 @@ public:
 private:
 	bool update()
 	{
+		m_previousRotation = m_rotation;
+		m_previousDistance = m_distance;
 		if (m_moving)
 		{
 
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 0.0f, 1.0f) * m_rotationMatrix;
+			m_rotation = (m_spin * m_rotation).normalized();
 
 			if (m_isgoingfar)
 			{
@@ -197,30 +234,22 @@ private:
 
 	}
 
-	void render()
+	// alpha: position between the previous and the current update, 0..1
+	void render(float alpha)
 	{
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, m_width, m_height);
+		m_state.viewport(0, 0, m_width, m_height);
 
 		const float h = 1.0f;
 		const float w = h * m_width / m_height;
 
 		const Matrix matrix =
 			Matrix::frustum(-w / 2, w / 2, -h / 2, h / 2, 1.0f, 50.0f)
-			* Matrix::translate(0.0f, 0.0f, -4.0f + m_distance)
-			* m_rotationMatrix;
-		glUniformMatrix4fv(m_matrixLocation, 1, GL_FALSE, matrix.data());
+			* Matrix::translate(0.0f, 0.0f, -4.0f + m_previousDistance + (m_distance - m_previousDistance) * alpha)
+			* Matrix::rotation(Quaternion::slerp(m_previousRotation, m_rotation, alpha));
+		m_program.set(m_matrixUniform, matrix.data());
 
-		const GLubyte indices[] =
-		{
-			0, 1, 2, 0, 2, 3, //front
-			4, 5, 6, 4, 6, 7, // back
-			8, 9, 10, 8, 10, 11, //left
-			12, 13, 14, 12, 14, 15, //right
-			16, 17, 18, 16, 18, 19, //top
-			20, 21, 22, 20, 22, 23, //bottom
-		};
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, indices);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, GpuBuffer::offset(0));
 
 		m_graphic.swapBuffers();
 	}
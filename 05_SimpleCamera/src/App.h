@@ -3,10 +3,17 @@
 #include <WindowListener.h>
 #include <Graphic.h>
 #include <Utils.h>
+#include <ShaderCache.h>
+#include <ShaderProgram.h>
+#include <GlStateCache.h>
+#include <GpuBuffer.h>
 #include <string>
 #include <cassert>
 #include <glmath.h>
 #include <Tga.h>
+#include <Mesh.h>
+#include <MeshOptimizer.h>
+#include <Texture.h>
 
 class App : public WindowListener
 {
@@ -14,11 +21,14 @@ private:
 	Graphic& m_graphic;
 	int m_width, m_height;
 
-	int m_numVertices;
-	float* m_vertices;
+	int m_numIndices;
+	GLenum m_indexType;
 	static const int STRIDE = sizeof(float) * 5;
+	GpuBuffer m_vertexBuffer, m_indexBuffer;
 
-	int m_matrixLocaiton;
+	ShaderProgram m_program;
+	GlStateCache m_state;
+	int m_matrixUniform;
 	Matrix m_matrix;
 
 	float m_yRotation;
@@ -28,32 +38,37 @@ private:
 	bool m_exit;
 
 private:
-	void loadVertices()
+	// Prefers world.mesh, which the build makes from world.txt with MeshConverter
+	// and which uploads straight from its mapping. Only world.txt is checked in,
+	// so running from data/ parses and indexes the text instead.
+	void loadMesh()
 	{
-		FILE* f = fopen("world.txt", "rt");
-		assert(f);
-		int numTriangles;
-		fscanf(f, "%d", &numTriangles);
-		m_numVertices = numTriangles * 3;
-		m_vertices = new float[STRIDE * m_numVertices];
-		float* pointer = m_vertices;
-		for (int i = 0; i < m_numVertices; i++)
+		Mesh mesh("world.mesh");
+		if (mesh.okay() && mesh.indexCount())
 		{
-			float x, y, z, u, v;
-			fscanf(f, "%f %f %f %f %f", &x, &y, &z, &u, &v);
-			pointer[0] = x;
-			pointer[1] = y;
-			pointer[2] = z;
-			pointer[3] = u;
-			pointer[4] = v;
-			pointer += 5;
+			assert(mesh.vertexStride() == STRIDE);
+			m_vertexBuffer.upload(GL_ARRAY_BUFFER, mesh.vertices(), mesh.vertexBytes());
+			uploadIndices(mesh.indices(), mesh.indexCount(), mesh.indexSize());
+			return;
 		}
-		fclose(f);
+
+		std::vector<float> soup;
+		auto okay = Mesh::loadText("world.txt", soup);
+		assert(okay);
+		std::vector<unsigned char> vertices;
+		std::vector<uint32_t> indices;
+		MeshOptimizer::optimize(soup.data(), soup.size() / 5, STRIDE, vertices, indices);
+		m_vertexBuffer.upload(GL_ARRAY_BUFFER, vertices.data(), vertices.size());
+		auto indexSize = MeshOptimizer::indexSize(vertices.size() / STRIDE);
+		uploadIndices(MeshOptimizer::packIndices(indices, indexSize).data(), (int)indices.size(), indexSize);
 	}
 
-	void unloadVertices()
+	void uploadIndices(const void* indices, int count, int indexSize)
 	{
-		delete[] m_vertices;
+		assert(indexSize == 2 || (indexSize == 4 && Utils::hasExtension("GL_OES_element_index_uint")));
+		m_numIndices = count;
+		m_indexType = indexSize == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+		m_indexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, indices, (size_t)count * indexSize);
 	}
 
 public:
@@ -61,40 +76,40 @@ public:
 	{
 
 		auto vsSource = Utils::readFile("vs.glsl");
-		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
-		assert(vs > 0);
-
 		auto fsSource = Utils::readFile("fs.glsl");
-		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
-		assert(fs > 0);
 
-		auto program = Utils::linkProgram(vs, fs);
+		// Later launches load the linked program from disk
+		ShaderCache shaderCache;
+		auto program = shaderCache.load(vsSource, fsSource);
 		assert(program > 0);
-		glUseProgram(program);
+		printf("Program %s in %.2f ms\n", shaderCache.lastHit() ? "loaded from cache" : "compiled", shaderCache.lastMs());
+		m_program.reset(program);
+		m_program.use();
 
-		loadVertices();
+		// The world is static, so it is uploaded once
+		loadMesh();
 
-		auto positionLocation = glGetAttribLocation(program, "a_position");
+		auto positionLocation = m_program.attribute(ShaderProgram::hash("a_position"));
 		assert(positionLocation >= 0);
-		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, STRIDE, m_vertices);
+		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, STRIDE, GpuBuffer::offset(0));
 		glEnableVertexAttribArray(positionLocation);
 
-		auto texCoordLocation = glGetAttribLocation(program, "a_texCoord");
+		auto texCoordLocation = m_program.attribute(ShaderProgram::hash("a_texCoord"));
 		assert(texCoordLocation >= 0);
-		glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, STRIDE, m_vertices + 3);
+		glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, STRIDE, GpuBuffer::offset(3 * sizeof(float)));
 		glEnableVertexAttribArray(texCoordLocation);
 
-		m_matrixLocaiton = glGetUniformLocation(program, "u_matrix");
-		assert(m_matrixLocaiton >= 0);
+		m_matrixUniform = m_program.uniform(ShaderProgram::hash("u_matrix"));
+		assert(m_matrixUniform >= 0);
 
 		GLuint texture;
 		glGenTextures(1, &texture);
 		loadTexture(texture, "image.tga");
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, texture);
-		auto samplerLocation = glGetUniformLocation(program, "u_sampler");
-		assert(samplerLocation >= 0);
-		glUniform1i(samplerLocation, 0);
+		auto samplerUniform = m_program.uniform(ShaderProgram::hash("u_sampler"));
+		assert(samplerUniform >= 0);
+		m_program.set(samplerUniform, 0);
 
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glEnable(GL_DEPTH_TEST);
@@ -106,20 +121,13 @@ public:
 		m_walkBiasAngle = 0.0f;
 	}
 
-	~App()
-	{
-		unloadVertices();
-	}
 private:
 	void loadTexture(GLuint texture, const char* file)
 	{
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		auto tga = Tga(file);
 		assert(tga.okay());
-		auto format = tga.hasAlpha() ? GL_RGBA : GL_RGB;
-		glTexImage2D(GL_TEXTURE_2D, 0, format, tga.width(), tga.height(), 0, format, GL_UNSIGNED_BYTE, tga.data());
+		// The floor and walls tile many times into the distance
+		Texture::upload(texture, tga.width(), tga.height(), tga.hasAlpha(), tga.data(), Texture::Mipmap);
 	}
 
 public:
@@ -142,7 +150,7 @@ public:
 		switch (keycode)
 		{
 		case 'S':
-		case VK_DOWN:
+		case KEY_DOWN:
 			m_xTranslation += sinDeg(m_yRotation) * walkStep;
 			m_zTranslation += cosDeg(m_yRotation) * walkStep;
 			m_walkBiasAngle -= 10.0f;
@@ -150,7 +158,7 @@ public:
 			m_yTranslation = sinDeg(m_walkBiasAngle) / 20.0f + 0.25f;
 			break;
 		case 'W':
-		case VK_UP:
+		case KEY_UP:
 			m_xTranslation -= sinDeg(m_yRotation) * walkStep;
 			m_zTranslation -= cosDeg(m_yRotation) * walkStep;
 			m_walkBiasAngle += 10.0f;
@@ -158,19 +166,19 @@ public:
 			m_yTranslation = sinDeg(m_walkBiasAngle) / 20.0f + 0.25f;
 			break;
 		case 'A':
-		case VK_LEFT:
+		case KEY_LEFT:
 			m_yRotation += yRotationStep;
 			break;
 		case 'D':
-		case VK_RIGHT:
+		case KEY_RIGHT:
 			m_yRotation -= yRotationStep;
 			break;
-		case VK_SPACE:
+		case KEY_SPACE:
 			m_yRotation = 0.0f;
 			m_xTranslation = m_yTranslation = m_zTranslation = 0.0f;
 			m_walkBiasAngle = 0.0f;
 			break;
-		case VK_ESCAPE:
+		case KEY_ESCAPE:
 			m_exit = true;
 			break;
 		}
@@ -184,13 +192,13 @@ private:
 
 	void render() {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, m_width, m_height);
+		m_state.viewport(0, 0, m_width, m_height);
 		auto matrix =
 			Matrix::perspective(45.0f, (float)m_width / (float)m_height, 0.1f, 100.0f)
 			* Matrix::rotation(-m_yRotation, 0.0f, 1.0f, 0.0f)
 			* Matrix::translate(-m_xTranslation, -m_yTranslation, -m_zTranslation);
-		glUniformMatrix4fv(m_matrixLocaiton, 1, GL_FALSE, matrix.data());
-		glDrawArrays(GL_TRIANGLES, 0, m_numVertices);
+		m_program.set(m_matrixUniform, matrix.data());
+		glDrawElements(GL_TRIANGLES, m_numIndices, m_indexType, GpuBuffer::offset(0));
 		m_graphic.swapBuffers();
 	}
 
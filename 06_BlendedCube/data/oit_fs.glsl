@@ -0,0 +1,25 @@
+precision mediump float;
+
+varying vec2 v_texCoord;
+
+uniform sampler2D u_sampler;
+uniform float u_opacity;
+// false: accumulation pass, true: revealage pass; see WeightedOit.h
+uniform bool u_revealage;
+
+void main()
+{
+	vec3 color = texture2D(u_sampler, v_texCoord).rgb;
+	float alpha = gl_FrontFacing ? u_opacity : 1.0 - u_opacity;
+
+	if (u_revealage)
+	{
+		gl_FragColor = vec4(alpha);
+	}
+	else
+	{
+		// Nearer fragments weigh more (equation 10 of the paper)
+		float weight = alpha * max(0.01, 3000.0 * pow(1.0 - gl_FragCoord.z, 3.0));
+		gl_FragColor = vec4(color * alpha, alpha) * weight;
+	}
+}
\ No newline at end of file
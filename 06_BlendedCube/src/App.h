@@ -3,10 +3,22 @@
 #include <WindowListener.h>
 #include <Graphic.h>
 #include <Utils.h>
+#include <ShaderCache.h>
+#include <ShaderProgram.h>
+#include <GlStateCache.h>
+#include <RenderQueue.h>
+#include <TransparencySorter.h>
+#include <WeightedOit.h>
+#include <ShaderCompiler.h>
 #include <string>
+#include <vector>
 #include <cassert>
 #include <glmath.h>
 #include <Tga.h>
+#include <TextureAtlas.h>
+#include <AssetLoader.h>
+#include <GpuBuffer.h>
+#include <Profiler.h>
 
 
 class App : public WindowListener
@@ -14,35 +26,97 @@ class App : public WindowListener
 private:
 	Graphic& m_graphic;
 	int m_width, m_height;
-	int m_matrixLocation;
-	Matrix m_rotationMatrix;
+	ShaderProgram m_program;
+	GlStateCache m_state;
+	RenderQueue m_queue;
+	int m_matrixUniform;
+	GpuBuffer m_positionBuffer, m_texCoordBuffer, m_indexBuffer;
+	// Both programs share vs.glsl and are linked with these locations, so
+	// one attribute setup serves both
+	enum Attribute { PositionAttribute, TexCoordAttribute };
+	Quaternion m_rotation;
+	Quaternion m_spin;
 	float m_distance;
 	bool m_exit;
 	bool m_blendEnabled;
-	GLuint m_textures[6];
+	GLuint m_texture;
+
+	// The face images are mapped and packed into an atlas in the background,
+	// leaving only its upload to the GL thread; m_startTime measures how long
+	// the first frame and the textures take to show.
+	AssetLoader m_loader;
+	unsigned int m_startTime;
+	bool m_firstFrameShown;
 
 	bool m_isgoingfar;
 	bool m_moving;
 
 	float m_opacity;
-	float m_opacityLocation;
+	int m_opacityUniform;
+
+	// How the faces combine while blending is on; 'O' cycles through these.
+	// Additive needs no order. SortedAlpha is normal alpha blending over the
+	// cube's triangles sorted back to front each frame, rewritten into
+	// m_sortedIndexBuffer when their order changes. WeightedBlended draws
+	// unsorted into m_oit's targets with oit_fs.glsl and composites them.
+	enum BlendMode { Additive, SortedAlpha, WeightedBlended, BLEND_MODE_COUNT };
+	BlendMode m_blendMode;
+	static const int TRIANGLE_COUNT = 12;
+	TransparencySorter m_sorter;
+	GpuBuffer m_sortedIndexBuffer;
+	float m_triangleCenters[TRIANGLE_COUNT][3];
+	ShaderProgram m_oitProgram;
+	int m_oitMatrixUniform, m_oitOpacityUniform, m_oitRevealageUniform;
+	WeightedOit m_oit;
+	bool m_oitSupported;
+
+	// Written on exit to $PROFILE_OUT.csv and $PROFILE_OUT.json when the
+	// PROFILE_OUT environment variable is set, e.g. to /tmp/blended
+	Profiler m_profiler;
+	int m_updatePhase, m_uniformPhase, m_drawPhase, m_swapPhase;
 
 
 public:
 	App(Graphic& graphic, int width, int height) : m_graphic(graphic), m_width(width), m_height(height),
-		m_rotationMatrix(Matrix::identity())
+		m_rotation(Quaternion::identity()),
+		m_spin(Quaternion::identity()),
+		m_startTime(Utils::currentTime()),
+		m_firstFrameShown(false)
 	{
 		auto vsSource = Utils::readFile("vs.glsl");
-		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
-		assert(vs > 0);
-
 		auto fsSource = Utils::readFile("fs.glsl");
-		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
-		assert(fs > 0);
 
-		auto program = Utils::linkProgram(vs, fs);
+		// Later launches load the linked program from disk; otherwise it
+		// builds while the face images start decoding
+		ShaderCache shaderCache;
+		ShaderCompiler shaderCompiler(&shaderCache);
+		const std::vector<std::string> attributes = { "a_position", "a_texCoord" };
+		auto programTicket = shaderCompiler.submit(vsSource, fsSource, attributes);
+		m_oitSupported = WeightedOit::supported();
+		auto oitTicket = m_oitSupported ? shaderCompiler.submit(vsSource, Utils::readFile("oit_fs.glsl"), attributes) : -1;
+
+		// All six faces share one atlas texture, so the cube is a single draw;
+		// face i is sprite i
+		static const char* faceImages[6] =
+		{
+			"ngoctrinh.tga",
+			"haho.tga",
+			"hatang.tga",
+			"maiphuongthuy.tga",
+			"buiphuongnga.tga",
+			"midu.tga",
+		};
+		glGenTextures(1, &m_texture);
+		AssetLoader::placeholder(m_texture);
+		GLint maxTextureSize;
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+		m_loader.loadAtlas(std::vector<std::string>(faceImages, faceImages + 6), maxTextureSize);
+
+		auto program = shaderCompiler.wait(programTicket);
 		assert(program > 0);
-		glUseProgram(program);
+		printf("Program %s, ready after %u ms\n", shaderCache.hits() ? "loaded from cache" : "compiled", Utils::currentTime() - m_startTime);
+		m_program.reset(program);
+		m_program.use();
 
 		//
 #define A -1.0f, -1.0f,  1.0f
@@ -64,67 +138,55 @@ public:
 			D, C, H, G, // top
 			F, E, B, A, // bottom
 		};
-		auto positionLocation = glGetAttribLocation(program, "a_position");
-		assert(positionLocation >= 0);
-		glVertexAttribPointer(positionLocation, 3, GL_FLOAT, GL_FALSE, 0, positions);
-		glEnableVertexAttribArray(positionLocation);
+		m_positionBuffer.upload(GL_ARRAY_BUFFER, positions, sizeof(positions));
 
-		//
-#define FACE_TEX_COORDS\
-			0.0f, 0.0f,\
-			1.0f, 0.0f,\
-			1.0f, 1.0f,\
-			0.0f, 1.0f,
+		// Every face samples the placeholder until onAtlasLoaded fills these in
+		float texCoords[6 * 4 * 2] = {};
 
-		static float texCoords[] =
-		{
-			FACE_TEX_COORDS
-			FACE_TEX_COORDS
-			FACE_TEX_COORDS
-			FACE_TEX_COORDS
-			FACE_TEX_COORDS
-			FACE_TEX_COORDS
-		};
+		m_texCoordBuffer.upload(GL_ARRAY_BUFFER, texCoords, sizeof(texCoords));
+		setAttributes();
 
-		auto texCoordLocation = glGetAttribLocation(program, "a_texCoord");
-		assert(texCoordLocation >= 0);
-		glVertexAttribPointer(texCoordLocation, 2, GL_FLOAT, GL_FALSE, 0, texCoords);
-		glEnableVertexAttribArray(texCoordLocation);
+		//
+		auto indices = cubeIndices();
+		m_indexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, indices, TRIANGLE_COUNT * 3);
+		m_sortedIndexBuffer.upload(GL_ELEMENT_ARRAY_BUFFER, indices, TRIANGLE_COUNT * 3, GL_DYNAMIC_DRAW);
+		for (int triangle = 0; triangle < TRIANGLE_COUNT; ++triangle)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				auto sum = 0.0f;
+				for (int corner = 0; corner < 3; ++corner)
+					sum += positions[indices[triangle * 3 + corner] * 3 + axis];
+				m_triangleCenters[triangle][axis] = sum / 3;
+			}
+		}
 
 		//
-		m_matrixLocation = glGetUniformLocation(program, "u_matrix");
-		assert(m_matrixLocation >= 0);
+		m_matrixUniform = m_program.uniform(ShaderProgram::hash("u_matrix"));
+		assert(m_matrixUniform >= 0);
 
 		//
-		glGenTextures(6, m_textures);
-		int i = 0;
-		loadTexture(m_textures[i++], "ngoctrinh.tga");
-		loadTexture(m_textures[i++], "haho.tga");
-		loadTexture(m_textures[i++], "hatang.tga");
-		loadTexture(m_textures[i++], "maiphuongthuy.tga");
-		loadTexture(m_textures[i++], "buiphuongnga.tga");
-		loadTexture(m_textures[i++], "midu.tga");
-
-		auto samplerLocation = glGetUniformLocation(program, "u_sampler");
-		assert(samplerLocation >= 0);
-		glUniform1i(samplerLocation, 0);
-
-		glActiveTexture(GL_TEXTURE0);
+		auto samplerUniform = m_program.uniform(ShaderProgram::hash("u_sampler"));
+		assert(samplerUniform >= 0);
+		m_program.set(samplerUniform, 0);
+
 		//
 
 
 		//
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-		//
+		// render() sets the blend and depth state to match
 		m_blendEnabled = true;
-		glEnable(GL_BLEND);
 		glBlendColor(0.0f, 0.0f, 0.0f, 0.5f);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
 		//
 		m_distance = 0.0f;
 		m_exit = false;
+		m_spin =
+			Quaternion::rotation(-rotationStep, 0.0f, 0.0f, 1.0f)
+			* Quaternion::rotation(-rotationStep, 0.0f, 1.0f, 0.0f)
+			* Quaternion::rotation(-rotationStep, 1.0f, 0.0f, 0.0f);
 
 		m_isgoingfar = true;
 		m_moving = false;
@@ -133,26 +195,129 @@ public:
 
 
 
-		m_opacityLocation = glGetUniformLocation(program, "u_opacity");
-		assert(samplerLocation >= 0);
+		m_opacityUniform = m_program.uniform(ShaderProgram::hash("u_opacity"));
+		assert(m_opacityUniform >= 0);
+
+		m_blendMode = Additive;
+		if (m_oitSupported)
+		{
+			m_oitProgram.reset(shaderCompiler.wait(oitTicket));
+			assert(m_oitProgram.id() > 0);
+			m_oitProgram.use();
+			m_oitProgram.set(m_oitProgram.uniform(ShaderProgram::hash("u_sampler")), 0);
+			m_oitMatrixUniform = m_oitProgram.uniform(ShaderProgram::hash("u_matrix"));
+			m_oitOpacityUniform = m_oitProgram.uniform(ShaderProgram::hash("u_opacity"));
+			m_oitRevealageUniform = m_oitProgram.uniform(ShaderProgram::hash("u_revealage"));
+			assert(m_oitMatrixUniform >= 0 && m_oitOpacityUniform >= 0 && m_oitRevealageUniform >= 0);
+			m_program.use();
+		}
+
+		m_updatePhase = m_profiler.phase("update", false);
+		m_uniformPhase = m_profiler.phase("uniforms");
+		m_drawPhase = m_profiler.phase("draw");
+		m_swapPhase = m_profiler.phase("swap", false);
+	}
+
+	~App()
+	{
+		glDeleteTextures(1, &m_texture);
+		if (m_state.frames())
+		{
+			auto& total = m_state.total();
+			printf("GL state calls per frame: %.1f issued, %.1f filtered\n",
+				(float)total.issued / m_state.frames(), (float)total.filtered / m_state.frames());
+		}
+		auto& sorts = m_sorter.counters();
+		if (sorts.insertion + sorts.radix)
+			printf("Triangle sorts: %d by insertion, %d by radix\n", sorts.insertion, sorts.radix);
+		auto profilePath = Utils::environment("PROFILE_OUT");
+		if (!profilePath.empty())
+		{
+			auto written = m_profiler.dumpCsv((profilePath + ".csv").c_str());
+			written = m_profiler.dumpChromeTrace((profilePath + ".json").c_str()) && written;
+			printf(written ? "Profile written to %s.csv and .json\n" : "Could not write the profile to %s.csv and .json\n", profilePath.c_str());
+		}
 	}
 
 private:
-	void loadTexture(GLuint texture, const char* file)
+	// The cube's triangles, two per face in face order
+	static const GLubyte* cubeIndices()
 	{
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		auto tga = Tga(file);
-		assert(tga.okay());
-		auto format = tga.hasAlpha() ? GL_RGBA : GL_RGB;
-		glTexImage2D(GL_TEXTURE_2D, 0, format, tga.width(), tga.height(), 0, format, GL_UNSIGNED_BYTE, tga.data());
+		static const GLubyte indices[TRIANGLE_COUNT * 3] =
+		{
+			0, 1, 2, 0, 2, 3,
+			4, 5, 6, 4, 6, 7,
+			8, 9, 10, 8, 10, 11,
+			12, 13, 14, 12, 14, 15,
+			16, 17, 18, 16, 18, 19,
+			20, 21, 22, 20, 22, 23
+		};
+		return indices;
+	}
+
+	// Points the attribute arrays at the cube's buffers; WeightedOit::composite()
+	// uses one of them too
+	void setAttributes()
+	{
+		m_state.bindBuffer(GL_ARRAY_BUFFER, m_positionBuffer.id());
+		glVertexAttribPointer(PositionAttribute, 3, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
+		glEnableVertexAttribArray(PositionAttribute);
+		m_state.bindBuffer(GL_ARRAY_BUFFER, m_texCoordBuffer.id());
+		glVertexAttribPointer(TexCoordAttribute, 2, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
+		glEnableVertexAttribArray(TexCoordAttribute);
+	}
+
+	// Called on the GL thread once the worker has packed and composed the atlas
+	void onAtlasLoaded(TextureAtlas& atlas)
+	{
+		assert(atlas.width() > 0);
+		atlas.upload(m_texture);
+
+		static const float faceTexCoords[] =
+		{
+			0.0f, 0.0f,
+			1.0f, 0.0f,
+			1.0f, 1.0f,
+			0.0f, 1.0f,
+		};
+
+		float texCoords[6 * 4 * 2];
+		for (int face = 0; face < 6; ++face)
+		{
+			auto& rect = atlas.rect(face);
+			for (int corner = 0; corner < 4; ++corner)
+			{
+				texCoords[(face * 4 + corner) * 2 + 0] = rect.u(faceTexCoords[corner * 2 + 0]);
+				texCoords[(face * 4 + corner) * 2 + 1] = rect.v(faceTexCoords[corner * 2 + 1]);
+			}
+		}
+		m_texCoordBuffer.update(texCoords, sizeof(texCoords));
+		// Both of the above bind behind m_state's back
+		m_state.invalidate();
+
+		printf("Textures ready after %u ms\n", Utils::currentTime() - m_startTime);
 	}
+
 public:
 	bool tick()
 	{
+		m_profiler.beginFrame();
+		if (m_loader.pending())
+			m_loader.poll([](int, const Tga&) { }, [this](int, TextureAtlas& atlas) { onAtlasLoaded(atlas); });
 		render();
-		return update();
+		if (!m_firstFrameShown)
+		{
+			printf("First frame after %u ms\n", Utils::currentTime() - m_startTime);
+			m_firstFrameShown = true;
+		}
+		auto running = false;
+		{
+			Profiler::Scope scope(m_profiler, m_updatePhase);
+			running = update();
+		}
+		m_profiler.endFrame();
+		m_state.endFrame();
+		return running;
 	}
 
 	void onResized(int newWidth, int newHeight)
@@ -168,44 +333,43 @@ public:
 		const float distanceStep = 0.1f;
 		switch (keycode)
 		{
-		case VK_DOWN:
-			m_rotationMatrix = Matrix::rotation(rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
+		case KEY_DOWN:
+			m_rotation = (Quaternion::rotation(rotationStep, 1.0f, 0.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_UP:
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
+		case KEY_UP:
+			m_rotation = (Quaternion::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_LEFT:
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
+		case KEY_LEFT:
+			m_rotation = (Quaternion::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_RIGHT:
-			m_rotationMatrix = Matrix::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
+		case KEY_RIGHT:
+			m_rotation = (Quaternion::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotation).normalized();
 			break;
-		case VK_SPACE:
-			m_rotationMatrix = Matrix::identity();
+		case KEY_SPACE:
+			m_rotation = Quaternion::identity();
 			m_distance = 0.0f;
 			break;
-		case VK_RETURN:
+		case KEY_ENTER:
 			m_distance += distanceStep;
 			break;
-		case VK_BACK:
+		case KEY_BACKSPACE:
 			m_distance -= distanceStep;
 			break;
-		case VK_ESCAPE:
+		case KEY_ESCAPE:
 			m_exit = true;
 			break;
 		case 'B':
 			m_blendEnabled = !m_blendEnabled;
-			if (m_blendEnabled)
-			{
-				glEnable(GL_BLEND);
-				glDisable(GL_DEPTH_TEST);
-			}
-			else
-			{
-				glDisable(GL_BLEND);
-				glEnable(GL_DEPTH_TEST);
-			}
 			break;
+		case 'O':
+		{
+			static const char* names[BLEND_MODE_COUNT] = { "additive", "sorted alpha", "weighted blended OIT" };
+			m_blendMode = (BlendMode)((m_blendMode + 1) % BLEND_MODE_COUNT);
+			if (m_blendMode == WeightedBlended && !m_oitSupported)
+				m_blendMode = Additive;
+			printf("Blend mode: %s\n", names[m_blendMode]);
+			break;
+		}
 		case 'N':
 			m_opacity -= 0.05f;
 			if (m_opacity < 0)
@@ -222,7 +386,7 @@ public:
 			}
 			break;
 
-		case VK_TAB:
+		case KEY_TAB:
 			m_moving = !m_moving;
 			break;
 		}
@@ -235,13 +399,11 @@ private:
 	{
 		if (m_moving)
 		{
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 1.0f, 0.0f, 0.0f) * m_rotationMatrix;
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
-			m_rotationMatrix = Matrix::rotation(-rotationStep, 0.0f, 0.0f, 1.0f) * m_rotationMatrix;
+			m_rotation = (m_spin * m_rotation).normalized();
 
 			if (m_isgoingfar)
 			{
-				m_rotationMatrix = Matrix::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotationMatrix;
+				m_rotation = (Quaternion::rotation(rotationStep, 0.0f, 1.0f, 0.0f) * m_rotation).normalized();
 
 				m_distance -= distanceStep;
 				if (m_distance <= -5.0f)
@@ -262,41 +424,111 @@ private:
 		return !m_exit;
 	}
 
+	// The cube is one draw in every mode. Sorted alpha draws its triangles
+	// back to front; additive and weighted blended OIT results do not depend
+	// on order, so they draw them as they are.
+	void queueCube(const Matrix& modelView)
+	{
+		m_queue.clear();
+		RenderQueue::Command command = { m_program.id(), m_texture, m_indexBuffer.id(), GL_TRIANGLES, GL_UNSIGNED_BYTE, 36, 0, false, 0 };
+		if (!m_blendEnabled)
+		{
+			m_queue.add(RenderQueue::key(0, false, 0.0f, command.program, command.texture), command);
+			return;
+		}
+
+		command.translucent = true;
+		if (m_blendMode == SortedAlpha)
+		{
+			float depths[TRIANGLE_COUNT];
+			for (int triangle = 0; triangle < TRIANGLE_COUNT; ++triangle)
+			{
+				auto& c = m_triangleCenters[triangle];
+				depths[triangle] = -(modelView * Vector(c[0], c[1], c[2], 1.0f)).z();
+			}
+			m_sorter.sort(depths, TRIANGLE_COUNT);
+			if (m_sorter.changed())
+			{
+				GLubyte sorted[TRIANGLE_COUNT * 3];
+				m_sorter.writeIndices(cubeIndices(), 3, sorted);
+				// Bound through m_state, so update() rebinding it goes unnoticed
+				m_state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sortedIndexBuffer.id());
+				m_sortedIndexBuffer.update(sorted, sizeof(sorted));
+			}
+			command.indexBuffer = m_sortedIndexBuffer.id();
+			m_queue.add(RenderQueue::key(0, true, 0.0f, command.program, command.texture), command);
+			return;
+		}
+		if (m_blendMode == WeightedBlended)
+			command.program = m_oitProgram.id();
+		m_queue.add(RenderQueue::key(0, true, 0.0f, command.program, command.texture), command);
+	}
+
 	void render()
 	{
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, m_width, m_height);
+		m_state.viewport(0, 0, m_width, m_height);
+
+		// Stated in full every frame; GlStateCache drops what is already set.
+		// m_queue sets the program, texture, index buffer and blending per draw.
+		m_state.enable(GL_DEPTH_TEST, !m_blendEnabled);
+		m_state.blendFunc(GL_SRC_ALPHA, m_blendMode == SortedAlpha ? GL_ONE_MINUS_SRC_ALPHA : GL_ONE);
+		if (m_blendMode == WeightedBlended && !m_oit.resize(m_width, m_height))
+		{
+			printf("Weighted blended OIT targets are not renderable, back to additive\n");
+			m_oitSupported = false;
+			m_blendMode = Additive;
+		}
+		auto oit = m_blendEnabled && m_blendMode == WeightedBlended;
 
 		auto h = 1.0f;
 		auto w = h * m_width / m_height;
 
-		auto matrix =
-			Matrix::frustum(-w / 2, w / 2, -h / 2, h / 2, 1.0f, 50.0f)
-			* Matrix::translate(0.0f, 0.0f, -4.0f + m_distance)
-			* m_rotationMatrix;
-
-		glUniformMatrix4fv(m_matrixLocation, 1, GL_FALSE, matrix.data());
-		glUniform1f(m_opacityLocation, m_opacity);
+		const auto farPlane = 50.0f;
+		auto modelView = Matrix::translate(0.0f, 0.0f, -4.0f + m_distance) * Matrix::rotation(m_rotation);
+		auto matrix = Matrix::frustum(-w / 2, w / 2, -h / 2, h / 2, 1.0f, farPlane) * modelView;
 
-		GLubyte indices[] =
 		{
-			0, 1, 2, 0, 2, 3,
-			4, 5, 6, 4, 6, 7,
-			8, 9, 10, 8, 10, 11,
-			12, 13, 14, 12, 14, 15,
-			16, 17, 18, 16, 18, 19,
-			20, 21, 22, 20, 22, 23
-		};
+			Profiler::Scope scope(m_profiler, m_uniformPhase);
+			if (oit)
+			{
+				m_state.useProgram(m_oitProgram.id());
+				m_oitProgram.set(m_oitMatrixUniform, matrix.data());
+				m_oitProgram.set(m_oitOpacityUniform, m_opacity);
+			}
+			else
+			{
+				m_state.useProgram(m_program.id());
+				m_program.set(m_matrixUniform, matrix.data());
+				m_program.set(m_opacityUniform, m_opacity);
+			}
+		}
+
 
-		GLubyte* pointer = indices;
-		for (int i = 0; i < 6; ++i)
 		{
-			glBindTexture(GL_TEXTURE_2D, m_textures[i]);
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, pointer);\
-				pointer += 6;
+			Profiler::Scope scope(m_profiler, m_drawPhase);
+			queueCube(modelView);
+			m_queue.sort();
+			if (oit)
+			{
+				// The same draws once into each target
+				m_oit.beginAccumulation(m_state);
+				m_queue.submit(m_state, [this](const RenderQueue::Command&) { m_oitProgram.set(m_oitRevealageUniform, 0); });
+				m_oit.beginRevealage(m_state);
+				m_queue.submit(m_state, [this](const RenderQueue::Command&) { m_oitProgram.set(m_oitRevealageUniform, 1); });
+				m_oit.composite(m_state);
+				setAttributes();
+			}
+			else
+			{
+				m_queue.submit(m_state, [](const RenderQueue::Command&) { });
+			}
 		}
 
-		m_graphic.swapBuffers();
+		{
+			Profiler::Scope scope(m_profiler, m_swapPhase);
+			m_graphic.swapBuffers();
+		}
 	}
 
 };
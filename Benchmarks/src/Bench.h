@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Timing for the benchmarks: the best of several runs, so a stray context
+// switch does not count, and a sink the optimizer cannot see through.
+class Bench
+{
+public:
+	// Best time over repeats calls of body(), in milliseconds
+	template <typename Body>
+	static double best(Body body, int repeats = 5)
+	{
+		auto best = 1e30;
+		for (int i = 0; i < repeats; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			body();
+			auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (ms < best) best = ms;
+		}
+		return best;
+	}
+
+	// The same, with prepare() run untimed before each body(), e.g. to refill
+	// what body() sorts in place
+	template <typename Prepare, typename Body>
+	static double best(Prepare prepare, Body body, int repeats)
+	{
+		auto best = 1e30;
+		for (int i = 0; i < repeats; ++i)
+		{
+			prepare();
+			auto start = std::chrono::steady_clock::now();
+			body();
+			auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (ms < best) best = ms;
+		}
+		return best;
+	}
+
+	// Keeps value, and so the work behind it, from being optimized away
+	static void keep(float value)
+	{
+		sink() = value;
+	}
+
+	static void header(const char* name)
+	{
+		printf("\n== %s\n", name);
+	}
+
+	// Keeps the command line for option()
+	static void setArguments(int argc, char** argv)
+	{
+		arguments().assign(argv + 1, argv + argc);
+	}
+
+	// The value of a name=value argument, e.g. "mb=1000", or fallback
+	static long long option(const char* name, long long fallback)
+	{
+		const auto length = strlen(name);
+		for (auto argument : arguments())
+			if (strncmp(argument, name, length) == 0 && argument[length] == '=')
+				return atoll(argument + length + 1);
+		return fallback;
+	}
+
+	// A path in the system temporary directory for scratch files
+	static std::string temporaryPath(const char* name)
+	{
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+private:
+	static std::vector<const char*>& arguments()
+	{
+		static std::vector<const char*> values;
+		return values;
+	}
+
+	static volatile float& sink()
+	{
+		static volatile float value;
+		return value;
+	}
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <Graphic.h>
+#include <GpuBuffer.h>
+#include "Bench.h"
+
+// Indexed draws from client arrays, which the driver copies on every call,
+// against the same mesh uploaded once into GpuBuffer objects. Renders
+// headless with every face culled, so vertex fetch and the copies dominate.
+class GpuBufferBench
+{
+public:
+	// A GRID x GRID vertex grid, the most 16 bit indices can address
+	static const int GRID = 256;
+	static const int DRAWS = 20;
+	static const int SIZE = 64;
+
+	static void run()
+	{
+		Bench::header("gpubuffer: client arrays against GpuBuffer, 20 draws of 130k triangles");
+		Graphic graphic(SIZE, SIZE);
+
+		std::vector<float> positions;
+		std::vector<uint16_t> indices;
+		createGrid(positions, indices);
+		auto program = createProgram();
+		auto location = glGetAttribLocation(program, "a_position");
+		glUseProgram(program);
+		glViewport(0, 0, SIZE, SIZE);
+		// Vertices are still fetched and shaded, but nothing is rasterized
+		glEnable(GL_CULL_FACE);
+		glCullFace(GL_FRONT_AND_BACK);
+		glEnableVertexAttribArray(location);
+		const auto count = (GLsizei)indices.size();
+
+		auto clientMs = Bench::best([&]
+		{
+			for (int i = 0; i < DRAWS; ++i)
+			{
+				glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, positions.data());
+				glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, indices.data());
+			}
+			glFinish();
+		});
+
+		GpuBuffer vertices, elements;
+		vertices.upload(GL_ARRAY_BUFFER, positions.data(), positions.size() * sizeof(float));
+		elements.upload(GL_ELEMENT_ARRAY_BUFFER, indices.data(), indices.size() * sizeof(uint16_t));
+		auto bufferMs = Bench::best([&]
+		{
+			for (int i = 0; i < DRAWS; ++i)
+			{
+				glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
+				glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, GpuBuffer::offset(0));
+			}
+			glFinish();
+		});
+
+		glDisableVertexAttribArray(location);
+		glDisable(GL_CULL_FACE);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		glDeleteProgram(program);
+		printf("Client arrays %.2f ms, GpuBuffer %.2f ms (%.1fx)\n", clientMs, bufferMs, clientMs / bufferMs);
+	}
+
+private:
+	// Positions span clip space
+	static void createGrid(std::vector<float>& positions, std::vector<uint16_t>& indices)
+	{
+		for (int y = 0; y < GRID; ++y)
+			for (int x = 0; x < GRID; ++x)
+			{
+				positions.push_back(-1.0f + 2.0f * x / (GRID - 1));
+				positions.push_back(-1.0f + 2.0f * y / (GRID - 1));
+				positions.push_back(0.0f);
+			}
+
+		for (int y = 0; y + 1 < GRID; ++y)
+			for (int x = 0; x + 1 < GRID; ++x)
+			{
+				uint16_t corner = (uint16_t)(y * GRID + x);
+				uint16_t quad[] = { corner, (uint16_t)(corner + 1), (uint16_t)(corner + GRID),
+					(uint16_t)(corner + 1), (uint16_t)(corner + GRID + 1), (uint16_t)(corner + GRID) };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+	}
+
+	static GLuint createProgram()
+	{
+		static const char* vsSource =
+			"attribute vec3 a_position;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_Position = vec4(a_position, 1.0);\n"
+			"}\n";
+		static const char* fsSource =
+			"precision mediump float;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_FragColor = vec4(1.0);\n"
+			"}\n";
+
+		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
+		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
+		auto program = Utils::linkProgram(vs, fs);
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+		return program;
+	}
+};
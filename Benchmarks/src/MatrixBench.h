@@ -0,0 +1,94 @@
+#pragma once
+
+#include <math.h>
+#include <vector>
+#include <glmath.h>
+#include "Bench.h"
+
+// Matrix * Matrix and Matrix * Vector through the Simd layer against the
+// scalar loops they replaced, over COUNT independent products each
+class MatrixBench
+{
+public:
+	static const int COUNT = 1 << 20;
+
+	static void run()
+	{
+		Bench::header("matrix: Simd products against scalar loops, 1M each");
+		const auto viewProjection = Matrix::perspective(60.0f, 16.0f / 9.0f, 0.1f, 100.0f) * Matrix::translate(0.0f, -1.0f, -5.0f);
+
+		std::vector<Matrix> models(COUNT, Matrix::identity());
+		TransformBatch batch(COUNT);
+		std::vector<Vector> points(COUNT, Vector(0.0f, 0.0f, 0.0f, 1.0f));
+		for (int i = 0; i < COUNT; ++i)
+		{
+			models[i] = Matrix::translate((float)(i % 101), (float)(i % 37), -(float)(i % 53)) * Matrix::rotation((float)i, 0.0f, 1.0f, 0.0f);
+			batch.setModel(i, models[i]);
+			points[i] = Vector((float)(i % 7), (float)(i % 11), (float)(i % 13), 1.0f);
+		}
+
+		std::vector<Matrix> scalar(COUNT, Matrix::identity()), simd(COUNT, Matrix::identity());
+		auto scalarMs = Bench::best([&]
+		{
+			for (int i = 0; i < COUNT; ++i)
+				scalar[i] = Matrix::multiply(viewProjection, models[i]);
+			Bench::keep(scalar[COUNT - 1].at(0, 0));
+		});
+		auto simdMs = Bench::best([&]
+		{
+			for (int i = 0; i < COUNT; ++i)
+				simd[i] = viewProjection * models[i];
+			Bench::keep(simd[COUNT - 1].at(0, 0));
+		});
+		auto batchMs = Bench::best([&]
+		{
+			batch.transform(viewProjection);
+			Bench::keep(batch.data()[0]);
+		});
+
+		auto error = 0.0f;
+		for (int i = 0; i < COUNT; ++i)
+			for (int k = 0; k < 16; ++k)
+			{
+				error = (std::max)(error, fabsf(scalar[i].data()[k] - simd[i].data()[k]));
+				error = (std::max)(error, fabsf(scalar[i].data()[k] - batch.data()[i * 16 + k]));
+			}
+		printf("Matrix * Matrix: scalar %.2f ms, operator * %.2f ms (%.1fx), TransformBatch %.2f ms (%.1fx), max difference %g\n",
+			scalarMs, simdMs, scalarMs / simdMs, batchMs, scalarMs / batchMs, error);
+
+		std::vector<Vector> scalarPoints(points), simdPoints(points);
+		scalarMs = Bench::best([&]
+		{
+			for (int i = 0; i < COUNT; ++i)
+				scalarPoints[i] = transform(viewProjection, points[i]);
+			Bench::keep(scalarPoints[COUNT - 1].x());
+		});
+		simdMs = Bench::best([&]
+		{
+			for (int i = 0; i < COUNT; ++i)
+				simdPoints[i] = viewProjection * points[i];
+			Bench::keep(simdPoints[COUNT - 1].x());
+		});
+
+		error = 0.0f;
+		for (int i = 0; i < COUNT; ++i)
+			for (int k = 0; k < 4; ++k)
+				error = (std::max)(error, fabsf(scalarPoints[i].data()[k] - simdPoints[i].data()[k]));
+		printf("Matrix * Vector: scalar %.2f ms, operator * %.2f ms (%.1fx), max difference %g\n",
+			scalarMs, simdMs, scalarMs / simdMs, error);
+	}
+
+private:
+	// The row by column loop operator * used before the Simd layer
+	static Vector transform(const Matrix& a, const Vector& v)
+	{
+		float result[4];
+		for (int row = 0; row < 4; ++row)
+		{
+			auto sum = 0.0f;
+			for (int k = 0; k < 4; ++k) sum += a.at(row, k) * v.data()[k];
+			result[row] = sum;
+		}
+		return Vector(result);
+	}
+};
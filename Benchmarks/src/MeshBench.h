@@ -0,0 +1,154 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Mesh.h>
+#include "Bench.h"
+
+// Synthetic meshes of 10^3 triangles up to the tris option (10^6 by default,
+// tris=10000000 for the full range), written to the temporary directory as
+// world.txt style text and as a .mesh. Times the binary load, mapping,
+// validating and reading every vertex byte, against Mesh::loadText.
+// "meshtext" times loadText on one thread and on one per core (or the
+// threads option) against the fscanf loop it replaced, on mb megabytes of
+// text (64 by default, mb=1000 for the gigabyte the parser was tuned on),
+// and checks all three agree bit for bit.
+class MeshBench
+{
+public:
+	// About 39 bytes a vertex line
+	static const int TEXT_TRIANGLE_BYTES = 118;
+
+	static void run()
+	{
+		Bench::header("mesh: Mesh binary load against Mesh::loadText");
+		const auto maxTriangles = Bench::option("tris", 1000000);
+		const auto textPath = Bench::temporaryPath("MeshBench.txt");
+		const auto meshPath = Bench::temporaryPath("MeshBench.mesh");
+		for (long long triangles = 1000; triangles <= maxTriangles; triangles *= 10)
+		{
+			if (!writeText(textPath.c_str(), (size_t)triangles))
+			{
+				printf("Could not write %s\n", textPath.c_str());
+				break;
+			}
+			// The binary holds exactly what the text parses to
+			std::vector<float> vertices;
+			auto okay = Mesh::loadText(textPath.c_str(), vertices);
+			okay = okay && Mesh::write(meshPath.c_str(), vertices.data(), (uint32_t)(triangles * 3), 5 * sizeof(float),
+				Mesh::Position | Mesh::TexCoord);
+			if (!okay)
+			{
+				printf("Could not convert %s\n", textPath.c_str());
+				break;
+			}
+
+			const auto repeats = triangles < 1000000 ? 5 : 2;
+			std::vector<float> parsed;
+			auto textMs = Bench::best([&]
+			{
+				Mesh::loadText(textPath.c_str(), parsed);
+			}, repeats);
+			auto binaryMs = Bench::best([&]
+			{
+				Mesh mesh(meshPath.c_str());
+				if (mesh.okay()) Bench::keep((float)checksum(mesh.vertices(), mesh.vertexBytes()));
+			}, repeats);
+
+			Mesh mesh(meshPath.c_str());
+			const auto same = parsed == vertices && mesh.okay() && mesh.vertexBytes() == vertices.size() * sizeof(float) &&
+				memcmp(mesh.vertices(), vertices.data(), mesh.vertexBytes()) == 0;
+			printf("%9lld triangles, %7.1f MB text, %7.1f MB binary: loadText %9.2f ms, Mesh %7.2f ms (%.0fx)%s\n",
+				triangles, std::filesystem::file_size(textPath) / 1048576.0, std::filesystem::file_size(meshPath) / 1048576.0,
+				textMs, binaryMs, textMs / binaryMs, same ? "" : ", VERTICES DIFFER");
+		}
+		remove(textPath.c_str());
+		remove(meshPath.c_str());
+	}
+
+	static void runText()
+	{
+		Bench::header("meshtext: Mesh::loadText against fscanf");
+		const auto megabytes = Bench::option("mb", 64);
+		const auto path = Bench::temporaryPath("MeshBench.txt");
+		if (!writeText(path.c_str(), (size_t)(megabytes << 20) / TEXT_TRIANGLE_BYTES))
+		{
+			printf("Could not write %s\n", path.c_str());
+			return;
+		}
+
+		const auto threads = (int)Bench::option("threads", (std::max)(std::thread::hardware_concurrency(), 1u));
+		std::vector<float> scanned, single, parallel;
+		auto okay = true;
+		// One run of the fscanf loop, at a second a gigabyte, is plenty
+		auto scanMs = Bench::best([&] { okay = loadScanf(path.c_str(), scanned) && okay; }, 1);
+		auto singleMs = Bench::best([&] { okay = Mesh::loadText(path.c_str(), single, 1) && okay; }, 3);
+		auto parallelMs = Bench::best([&] { okay = Mesh::loadText(path.c_str(), parallel, threads) && okay; }, 3);
+		const auto bytes = scanned.size() * sizeof(float);
+		const auto same = okay && single.size() == scanned.size() && parallel.size() == scanned.size() &&
+			memcmp(single.data(), scanned.data(), bytes) == 0 && memcmp(parallel.data(), scanned.data(), bytes) == 0;
+
+		printf("%.1f MB, %zu triangles%s\n", std::filesystem::file_size(path) / 1048576.0, scanned.size() / 15,
+			same ? ", all bit identical" : ", RESULTS DIFFER");
+		printf("fscanf %.0f ms, loadText on 1 thread %.0f ms (%.1fx), on %d threads %.0f ms (%.1fx)\n",
+			scanMs, singleMs, scanMs / singleMs, threads, parallelMs, scanMs / parallelMs);
+		remove(path.c_str());
+	}
+
+	// Random triangles in the text format, x y z u v per line with 4 decimals
+	static bool writeText(const char* filePath, size_t triangles)
+	{
+		FILE* file = fopen(filePath, "wb");
+		if (!file) return false;
+		std::mt19937 random(5);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f), texCoord(0.0f, 1.0f);
+		std::vector<char> buffer(1 << 20);
+		size_t used = snprintf(buffer.data(), buffer.size(), "%zu\n", triangles);
+		auto okay = true;
+		for (size_t i = 0; i < triangles * 3 && okay; ++i)
+		{
+			used += snprintf(buffer.data() + used, buffer.size() - used, "%.4f %.4f %.4f %.4f %.4f\n",
+				position(random), position(random), position(random), texCoord(random), texCoord(random));
+			if (buffer.size() - used < 256)
+			{
+				okay = fwrite(buffer.data(), 1, used, file) == used;
+				used = 0;
+			}
+		}
+		okay = okay && fwrite(buffer.data(), 1, used, file) == used;
+		return fclose(file) == 0 && okay;
+	}
+
+private:
+	// The loader before Mesh::loadText
+	static bool loadScanf(const char* filePath, std::vector<float>& vertices)
+	{
+		int numTriangles;
+		FILE* file = fopen(filePath, "rt");
+		if (!file) return false;
+		if (fscanf(file, "%d", &numTriangles) != 1 || numTriangles < 0) { fclose(file); return false; }
+		vertices.resize((size_t)numTriangles * 3 * 5);
+		auto pointer = vertices.data();
+		bool okay = true;
+		for (int i = 0; i < numTriangles * 3 && okay; i++, pointer += 5)
+			okay = fscanf(file, "%f %f %f %f %f", &pointer[0], &pointer[1], &pointer[2], &pointer[3], &pointer[4]) == 5;
+		fclose(file);
+		return okay;
+	}
+
+	// Sums the blob a word at a time, so every page is really read
+	static uint32_t checksum(const void* data, size_t bytes)
+	{
+		auto words = (const uint32_t*)data;
+		uint32_t sum = 0;
+		for (size_t i = 0; i < bytes / 4; ++i)
+			sum += words[i];
+		return sum;
+	}
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+#include <RenderQueue.h>
+#include "Bench.h"
+
+// RenderQueue::sort() against std::stable_sort over the same random keys:
+// a mix of layers, opaque and translucent draws, depths and 40 programs x
+// 200 textures. Small queues are timed many at a time.
+class RenderQueueBench
+{
+public:
+	// Draws timed per size, split over as many queues as it takes
+	static const int DRAWS = 100000;
+
+	static void run()
+	{
+		Bench::header("renderqueue: radix sort against std::stable_sort, random keys");
+		static const int sizes[] = { 6, 48, 1000, 10000, 100000 };
+		for (auto size : sizes)
+			compare(size);
+	}
+
+private:
+	typedef std::vector<std::pair<uint64_t, uint32_t>> Keys;
+
+	static void compare(int size)
+	{
+		const int count = (std::max)(DRAWS / size, 1);
+		std::vector<RenderQueue> queues(count);
+		std::vector<Keys> keys(count);
+		std::mt19937_64 random(size);
+		std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+		auto fill = [&]
+		{
+			for (int q = 0; q < count; ++q)
+			{
+				queues[q].clear();
+				keys[q].clear();
+				for (int i = 0; i < size; ++i)
+				{
+					auto translucent = random() % 3 == 0;
+					auto key = RenderQueue::key((int)(random() % 2), translucent, depth(random), (GLuint)(random() % 40), (GLuint)(random() % 200));
+					RenderQueue::Command command = {};
+					command.user = i;
+					queues[q].add(key, command);
+					keys[q].push_back(std::make_pair(key, (uint32_t)i));
+				}
+			}
+		};
+
+		auto radixMs = Bench::best(fill, [&]
+		{
+			for (auto& queue : queues) queue.sort();
+		}, 5);
+		auto stableMs = Bench::best(fill, [&]
+		{
+			for (auto& k : keys)
+				std::stable_sort(k.begin(), k.end(), [](const Keys::value_type& a, const Keys::value_type& b) { return a.first < b.first; });
+		}, 5);
+
+		fill();
+		auto mismatches = 0;
+		for (int q = 0; q < count; ++q)
+		{
+			queues[q].sort();
+			std::stable_sort(keys[q].begin(), keys[q].end(), [](const Keys::value_type& a, const Keys::value_type& b) { return a.first < b.first; });
+			for (int i = 0; i < size; ++i)
+				mismatches += queues[q].keys()[i] != keys[q][i].first;
+		}
+
+		const auto perQueue = 1000.0 / count;
+		printf("%6d draws: radix %9.2f us, std::stable_sort %9.2f us (%.1fx)%s\n",
+			size, radixMs * perQueue, stableMs * perQueue, stableMs / radixMs, mismatches ? ", KEYS DIFFER" : "");
+	}
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <Swizzle.h>
+#include <Tga.h>
+#include "Bench.h"
+
+// 06_BlendedCube's haho.tga re-encoded as each image type Tga decodes,
+// written to the temporary directory, with the size and decode time of each.
+// Then the six cube faces loaded through the mapping, by Tga and by TgaView
+// plus the swizzle TextureAtlas does, against the fread, new[] and in place
+// swap loader they replaced. Run from the repository, Benchmarks or its
+// output directory, so the data directory is found.
+class TgaBench
+{
+public:
+	static void run()
+	{
+		Bench::header("tga: Tga decode per image type, and the mapped loaders against fread");
+		const auto source = dataPath("haho.tga");
+		Tga tga(source.c_str());
+		if (!tga.okay() || tga.hasAlpha())
+		{
+			printf("Could not load 24 bit %s\n", source.c_str());
+			return;
+		}
+		const int width = tga.width(), height = tga.height();
+		const auto rgb = tga.data();
+
+		// Every type stores its pixels in file order, bottom row first
+		std::vector<unsigned char> bgr(rgb, rgb + width * height * 3), gray(width * height), indices(width * height);
+		std::vector<unsigned char> palette(256 * 3);
+		for (int i = 0; i < width * height; ++i)
+		{
+			auto p = rgb + i * 3;
+			std::swap(bgr[i * 3], bgr[i * 3 + 2]);
+			gray[i] = (unsigned char)((p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8);
+			// 3-3-2 bit color cube
+			indices[i] = (unsigned char)((p[0] & 0xe0) | ((p[1] >> 3) & 0x1c) | (p[2] >> 6));
+		}
+		for (int i = 0; i < 256; ++i)
+		{
+			// Stored as BGR
+			palette[i * 3 + 2] = (unsigned char)((i & 0xe0) | 0x10);
+			palette[i * 3 + 1] = (unsigned char)(((i << 3) & 0xe0) | 0x10);
+			palette[i * 3] = (unsigned char)(((i << 6) & 0xc0) | 0x20);
+		}
+
+		struct Variant
+		{
+			int type;
+			const char* name;
+			const std::vector<unsigned char>& pixels;
+			int bytes;
+		};
+		const Variant variants[] =
+		{
+			{ Tga::ImageTrueColor, "true color", bgr, 3 },
+			{ Tga::ImageTrueColor | Tga::ImageRunLength, "true color RLE", bgr, 3 },
+			{ Tga::ImageColorMapped, "color-mapped", indices, 1 },
+			{ Tga::ImageColorMapped | Tga::ImageRunLength, "color-mapped RLE", indices, 1 },
+			{ Tga::ImageGrayscale, "grayscale", gray, 1 },
+			{ Tga::ImageGrayscale | Tga::ImageRunLength, "grayscale RLE", gray, 1 },
+		};
+
+		// Each RLE variant must decode to what its raw twin does
+		std::vector<unsigned char> raw;
+		for (auto& variant : variants)
+		{
+			const auto path = Bench::temporaryPath("TgaBench.tga");
+			const auto mapped = (variant.type & ~Tga::ImageRunLength) == Tga::ImageColorMapped;
+			if (!write(path.c_str(), variant.type, width, height, variant.pixels, variant.bytes, mapped ? &palette : NULL))
+			{
+				printf("Could not write %s\n", path.c_str());
+				return;
+			}
+
+			auto ms = Bench::best([&]
+			{
+				Tga decoded(path.c_str());
+				Bench::keep(decoded.okay() ? decoded.data()[0] : 0.0f);
+			}, 20);
+
+			Tga decoded(path.c_str());
+			const auto bytes = (size_t)width * height * 3;
+			auto same = decoded.okay();
+			if (same && !(variant.type & Tga::ImageRunLength)) raw.assign(decoded.data(), decoded.data() + bytes);
+			else if (same) same = memcmp(decoded.data(), raw.data(), bytes) == 0;
+			printf("type %2d %-17s %5.0f KB, decode %.2f ms%s\n", variant.type, variant.name,
+				std::filesystem::file_size(path) / 1024.0, ms, same ? "" : ", DECODE DIFFERS");
+			remove(path.c_str());
+		}
+		loadFaces();
+	}
+
+private:
+	static void loadFaces()
+	{
+		static const char* files[] = { "ngoctrinh.tga", "haho.tga", "hatang.tga", "maiphuongthuy.tga", "buiphuongnga.tga", "midu.tga" };
+		std::vector<std::string> paths;
+		for (auto file : files)
+			paths.push_back(dataPath(file));
+
+		// The reference pixels, and room for TgaView to swizzle into as the atlas does
+		std::vector<std::vector<unsigned char>> expected;
+		size_t largest = 0;
+		for (auto& path : paths)
+		{
+			Tga tga(path.c_str());
+			if (!tga.okay())
+			{
+				printf("Could not load %s\n", path.c_str());
+				return;
+			}
+			const auto bytes = (size_t)tga.width() * tga.height() * (tga.hasAlpha() ? 4 : 3);
+			expected.emplace_back(tga.data(), tga.data() + bytes);
+			largest = (std::max)(largest, bytes);
+		}
+		std::vector<unsigned char> atlas(largest);
+
+		auto stdioMs = Bench::best([&]
+		{
+			for (auto& path : paths)
+			{
+				auto data = loadStdio(path.c_str());
+				Bench::keep(data ? data[0] : 0.0f);
+				delete[] data;
+			}
+		}, 20);
+		auto tgaMs = Bench::best([&]
+		{
+			for (auto& path : paths)
+			{
+				Tga tga(path.c_str());
+				Bench::keep(tga.okay() ? tga.data()[0] : 0.0f);
+			}
+		}, 20);
+		auto viewMs = Bench::best([&]
+		{
+			for (auto& path : paths)
+			{
+				TgaView view(path.c_str());
+				if (view.okay()) Swizzle::swap(view.bgrData(), atlas.data(), view.size() / view.channels(), view.channels());
+				Bench::keep(atlas[0]);
+			}
+		}, 20);
+
+		auto same = true;
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			auto data = loadStdio(paths[i].c_str());
+			same = same && data && memcmp(data, expected[i].data(), expected[i].size()) == 0;
+			delete[] data;
+			TgaView view(paths[i].c_str());
+			same = same && view.okay();
+			if (!same) break;
+			Swizzle::swap(view.bgrData(), atlas.data(), view.size() / view.channels(), view.channels());
+			same = memcmp(atlas.data(), expected[i].data(), expected[i].size()) == 0;
+		}
+
+		printf("Six 512x512 faces: fread and swap %.2f ms, Tga %.2f ms (%.1fx), TgaView and swizzle %.2f ms (%.1fx)%s\n",
+			stdioMs, tgaMs, stdioMs / tgaMs, viewMs, stdioMs / viewMs, same ? "" : ", PIXELS DIFFER");
+	}
+
+	// The loader before MappedFile: stdio reads into new[], then R and B
+	// swapped in place. Only raw true color, like it was.
+	static unsigned char* loadStdio(const char* filePath)
+	{
+		FILE* file = fopen(filePath, "rb");
+		if (!file) return NULL;
+		unsigned char garbage, type, bitsPerPixel;
+		short shortGarbage, width, height;
+		fread(&garbage, 1, 1, file);
+		fread(&garbage, 1, 1, file);
+		fread(&type, 1, 1, file);
+		fread(&shortGarbage, 2, 1, file);
+		fread(&shortGarbage, 2, 1, file);
+		fread(&garbage, 1, 1, file);
+		fread(&shortGarbage, 2, 1, file);
+		fread(&shortGarbage, 2, 1, file);
+		fread(&width, 2, 1, file);
+		fread(&height, 2, 1, file);
+		fread(&bitsPerPixel, 1, 1, file);
+		fread(&garbage, 1, 1, file);
+		if (type != Tga::ImageTrueColor || (bitsPerPixel != 24 && bitsPerPixel != 32)) { fclose(file); return NULL; }
+
+		const int channels = bitsPerPixel / 8;
+		const size_t total = (size_t)width * height * channels;
+		auto data = new unsigned char[total];
+		fread(data, 1, total, file);
+		fclose(file);
+		for (size_t i = 0; i < total; i += channels)
+		{
+			auto tmp = data[i];
+			data[i] = data[i + 2];
+			data[i + 2] = tmp;
+		}
+		return data;
+	}
+
+	static std::string dataPath(const char* file)
+	{
+		static const char* directories[] = { "06_BlendedCube/data/", "../06_BlendedCube/data/", "../../06_BlendedCube/data/" };
+		for (auto directory : directories)
+		{
+			auto path = std::string(directory) + file;
+			if (std::filesystem::exists(path)) return path;
+		}
+		return file;
+	}
+
+	// A bottom-up TGA of pixels, bytes per pixel, run-length encoded if type
+	// says so, with an optional 24 bit color map
+	static bool write(const char* filePath, int type, int width, int height, const std::vector<unsigned char>& pixels,
+		int bytes, const std::vector<unsigned char>* palette)
+	{
+		unsigned char header[Tga::Header::SIZE] = {};
+		header[1] = palette ? 1 : 0;
+		header[2] = (unsigned char)type;
+		if (palette)
+		{
+			const auto entries = palette->size() / 3;
+			header[5] = (unsigned char)entries;
+			header[6] = (unsigned char)(entries >> 8);
+			header[7] = 24;
+		}
+		header[12] = (unsigned char)width;
+		header[13] = (unsigned char)(width >> 8);
+		header[14] = (unsigned char)height;
+		header[15] = (unsigned char)(height >> 8);
+		header[16] = (unsigned char)(bytes * 8);
+
+		std::vector<unsigned char> out(header, header + sizeof(header));
+		if (palette) out.insert(out.end(), palette->begin(), palette->end());
+		if (type & Tga::ImageRunLength) encodeRunLength(pixels, bytes, out);
+		else out.insert(out.end(), pixels.begin(), pixels.end());
+
+		FILE* file = fopen(filePath, "wb");
+		if (!file) return false;
+		auto okay = fwrite(out.data(), 1, out.size(), file) == out.size();
+		return fclose(file) == 0 && okay;
+	}
+
+	// Repeat packets for runs of two or more equal pixels, literal packets
+	// for everything in between, at most 128 pixels each
+	static void encodeRunLength(const std::vector<unsigned char>& pixels, int bytes, std::vector<unsigned char>& out)
+	{
+		const size_t count = pixels.size() / bytes;
+		auto pixel = [&](size_t i) { return pixels.data() + i * bytes; };
+		auto repeats = [&](size_t i) { return i + 1 < count && memcmp(pixel(i), pixel(i + 1), bytes) == 0; };
+		size_t i = 0;
+		while (i < count)
+		{
+			size_t run = 1;
+			if (repeats(i))
+			{
+				while (i + run < count && run < 128 && memcmp(pixel(i), pixel(i + run), bytes) == 0) ++run;
+				out.push_back((unsigned char)(0x80 | (run - 1)));
+				out.insert(out.end(), pixel(i), pixel(i) + bytes);
+			}
+			else
+			{
+				while (i + run < count && run < 128 && !repeats(i + run)) ++run;
+				out.push_back((unsigned char)(run - 1));
+				out.insert(out.end(), pixel(i), pixel(i) + run * bytes);
+			}
+			i += run;
+		}
+	}
+};
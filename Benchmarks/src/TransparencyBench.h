@@ -0,0 +1,249 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <glmath.h>
+#include <Graphic.h>
+#include <GlStateCache.h>
+#include <GpuBuffer.h>
+#include <ShaderProgram.h>
+#include <TransparencySorter.h>
+#include <WeightedOit.h>
+#include "Bench.h"
+
+// QUADS translucent quads scattered through a cube. "sorter" times
+// TransparencySorter against std::stable_sort while the eye orbits the cube
+// at a few speeds, from coherent frames the insertion sort finishes to jumps
+// that fall back to the radix sort. "oit" renders whole headless frames of
+// sorted alpha blending against weighted blended OIT (WeightedOit).
+class TransparencyBench
+{
+public:
+	static const int QUADS = 100000;
+	static const int SORT_FRAMES = 100;
+	static const int DRAW_FRAMES = 10;
+	static const int SIZE = 400;
+
+	static void runSorter()
+	{
+		Bench::header("sorter: TransparencySorter against std::stable_sort, 100k quads");
+		std::vector<float> centers;
+		std::vector<uint32_t> indices;
+		createQuads(centers, indices, NULL);
+		// At 150 units the eye moves 0.13 units a frame at 0.05 degrees
+		static const float steps[] = { 0.05f, 0.25f, 30.0f };
+		for (auto step : steps)
+			sortFrames(centers, indices, step);
+	}
+
+	static void runOit()
+	{
+		Bench::header("oit: sorted alpha against weighted blended OIT, 100k quads at 400x400");
+		Graphic graphic(SIZE, SIZE);
+		if (!WeightedOit::supported() || !Utils::hasExtension("GL_OES_element_index_uint"))
+		{
+			printf("Needs GL_OES_texture_half_float, GL_EXT_color_buffer_half_float and GL_OES_element_index_uint\n");
+			return;
+		}
+
+		std::vector<float> centers, positions;
+		std::vector<uint32_t> indices;
+		createQuads(centers, indices, &positions);
+		std::vector<uint32_t> sorted(indices.size());
+		std::vector<float> depths(QUADS);
+
+		GlStateCache state;
+		GpuBuffer vertices, elements;
+		vertices.upload(GL_ARRAY_BUFFER, positions.data(), positions.size() * sizeof(float));
+		elements.upload(GL_ELEMENT_ARRAY_BUFFER, indices.data(), indices.size() * sizeof(uint32_t), GL_DYNAMIC_DRAW);
+		ShaderProgram alpha, oit;
+		alpha.reset(createProgram(false));
+		oit.reset(createProgram(true));
+		WeightedOit targets;
+		auto okay = targets.resize(SIZE, SIZE);
+		assert(okay);
+		// All of the above bind behind state's back
+		state.invalidate();
+
+		TransparencySorter sorter;
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			auto& program = mode ? oit : alpha;
+			const auto matrixUniform = program.uniform(ShaderProgram::hash("u_matrix"));
+			const auto revealageUniform = program.uniform(ShaderProgram::hash("u_revealage"));
+			const auto location = program.attribute(ShaderProgram::hash("a_position"));
+			double frameMs = 0.0, sortMs = 0.0;
+			for (int frame = 0; frame <= DRAW_FRAMES; ++frame)
+			{
+				auto view = Matrix::translate(0.0f, 0.0f, -60.0f) * Matrix::rotation(frame * 3.0f, 0.0f, 1.0f, 0.0f);
+				auto matrix = Matrix::frustum(-0.5f, 0.5f, -0.5f, 0.5f, 1.0f, 200.0f) * view;
+				glFinish();
+				auto start = std::chrono::steady_clock::now();
+
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				state.viewport(0, 0, SIZE, SIZE);
+				state.enable(GL_DEPTH_TEST, false);
+				state.enable(GL_BLEND, true);
+				state.depthMask(false);
+				state.useProgram(program.id());
+				program.set(matrixUniform, matrix.data());
+				state.bindBuffer(GL_ARRAY_BUFFER, vertices.id());
+				glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
+				glEnableVertexAttribArray(location);
+				state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, elements.id());
+				const auto count = (GLsizei)indices.size();
+
+				if (mode == 0)
+				{
+					auto sortStart = std::chrono::steady_clock::now();
+					for (int i = 0; i < QUADS; ++i)
+						depths[i] = -(view * Vector(centers[i * 3], centers[i * 3 + 1], centers[i * 3 + 2], 1.0f)).z();
+					sorter.sort(depths.data(), QUADS);
+					if (sorter.changed())
+					{
+						sorter.writeIndices(indices.data(), 6, sorted.data());
+						elements.update(sorted.data(), sorted.size() * sizeof(uint32_t));
+					}
+					if (frame) sortMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sortStart).count();
+					state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+					glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, GpuBuffer::offset(0));
+				}
+				else
+				{
+					targets.beginAccumulation(state);
+					program.set(revealageUniform, 0);
+					glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, GpuBuffer::offset(0));
+					targets.beginRevealage(state);
+					program.set(revealageUniform, 1);
+					glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, GpuBuffer::offset(0));
+					targets.composite(state);
+				}
+
+				glFinish();
+				// The first frame pays for shader and target setup
+				if (frame) frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			if (mode == 0)
+				printf("Sorted alpha: %.1f ms per frame, of which %.1f ms depth, sort and index upload\n", frameMs / DRAW_FRAMES, sortMs / DRAW_FRAMES);
+			else
+				printf("Weighted blended OIT: %.1f ms per frame\n", frameMs / DRAW_FRAMES);
+		}
+		state.depthMask(true);
+	}
+
+private:
+	// Quad i has its center at centers[i * 3] and indices[i * 6] onwards;
+	// positions, if wanted, get its four corners, facing +z
+	static void createQuads(std::vector<float>& centers, std::vector<uint32_t>& indices, std::vector<float>* positions)
+	{
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> coordinate(-20.0f, 20.0f);
+		const float half = 0.15f;
+		for (uint32_t i = 0; i < QUADS; ++i)
+		{
+			float center[] = { coordinate(random), coordinate(random), coordinate(random) };
+			centers.insert(centers.end(), center, center + 3);
+			const uint32_t first = i * 4;
+			uint32_t quad[] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+			indices.insert(indices.end(), quad, quad + 6);
+			if (!positions) continue;
+			float corners[] =
+			{
+				center[0] - half, center[1] - half, center[2],
+				center[0] + half, center[1] - half, center[2],
+				center[0] + half, center[1] + half, center[2],
+				center[0] - half, center[1] + half, center[2],
+			};
+			positions->insert(positions->end(), corners, corners + 12);
+		}
+	}
+
+	// SORT_FRAMES frames with the eye orbiting at 150 units, step degrees apart
+	static void sortFrames(const std::vector<float>& centers, const std::vector<uint32_t>& indices, float step)
+	{
+		TransparencySorter sorter;
+		std::vector<float> depths(QUADS);
+		std::vector<uint32_t> out(indices.size()), reference(QUADS);
+		double sortMs = 0.0, writeMs = 0.0, stableMs = 0.0;
+		auto mismatches = 0;
+		for (int frame = 0; frame <= SORT_FRAMES; ++frame)
+		{
+			const auto eyeX = 150.0f * sinDeg(frame * step), eyeZ = 150.0f * cosDeg(frame * step);
+			for (int i = 0; i < QUADS; ++i)
+			{
+				auto dx = centers[i * 3] - eyeX, dy = centers[i * 3 + 1], dz = centers[i * 3 + 2] - eyeZ;
+				depths[i] = sqrtf(dx * dx + dy * dy + dz * dz);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			sorter.sort(depths.data(), QUADS);
+			auto sorted = std::chrono::steady_clock::now();
+			if (sorter.changed())
+				sorter.writeIndices(indices.data(), 6, out.data());
+			auto written = std::chrono::steady_clock::now();
+			for (int i = 0; i < QUADS; ++i)
+				reference[i] = i;
+			std::stable_sort(reference.begin(), reference.end(), [&](uint32_t a, uint32_t b) { return depths[a] > depths[b]; });
+			auto end = std::chrono::steady_clock::now();
+
+			// The first frame sorts from scratch
+			if (frame)
+			{
+				sortMs += std::chrono::duration<double, std::milli>(sorted - start).count();
+				writeMs += std::chrono::duration<double, std::milli>(written - sorted).count();
+				stableMs += std::chrono::duration<double, std::milli>(end - written).count();
+			}
+			for (int i = 0; i < QUADS; ++i)
+				mismatches += depths[sorter.order()[i]] != depths[reference[i]];
+		}
+
+		auto& counters = sorter.counters();
+		printf("%5.2f deg per frame: sort %.2f ms, index rewrite %.2f ms, std::stable_sort %.2f ms (%d insertion, %d radix)%s\n",
+			step, sortMs / SORT_FRAMES, writeMs / SORT_FRAMES, stableMs / SORT_FRAMES, counters.insertion, counters.radix,
+			mismatches ? ", ORDER DIFFERS" : "");
+	}
+
+	// Colour from the position; the OIT variant weighs fragments as 06's oit_fs.glsl does
+	static GLuint createProgram(bool weighted)
+	{
+		static const char* vsSource =
+			"attribute vec3 a_position;\n"
+			"uniform mat4 u_matrix;\n"
+			"varying vec3 v_color;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_Position = u_matrix * vec4(a_position, 1.0);\n"
+			"	v_color = fract(a_position * 0.37);\n"
+			"}\n";
+		static const char* alphaSource =
+			"precision mediump float;\n"
+			"varying vec3 v_color;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_FragColor = vec4(v_color, 0.3);\n"
+			"}\n";
+		static const char* oitSource =
+			"precision mediump float;\n"
+			"varying vec3 v_color;\n"
+			"uniform bool u_revealage;\n"
+			"void main()\n"
+			"{\n"
+			"	float alpha = 0.3;\n"
+			"	float weight = alpha * max(0.01, 3000.0 * pow(1.0 - gl_FragCoord.z, 3.0));\n"
+			"	gl_FragColor = u_revealage ? vec4(alpha) : vec4(v_color * alpha, alpha) * weight;\n"
+			"}\n";
+
+		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
+		auto fs = Utils::compileShader(weighted ? oitSource : alphaSource, GL_FRAGMENT_SHADER);
+		auto program = Utils::linkProgram(vs, fs);
+		assert(program);
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+		return program;
+	}
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <math.h>
+#include <vector>
+#include <glmath.h>
+#include "Bench.h"
+
+// The sinDeg/cosDeg implementations in glmath.h (see GLMATH_TRIG): max
+// error against double precision sin, and throughput over COUNT angles
+class TrigBench
+{
+public:
+	static const int COUNT = 1 << 22;
+
+	static void run()
+	{
+		Bench::header("trig: sinDeg modes against libm, 4M angles");
+		printf("%-6s %12s %12s %10s %8s\n", "mode", "err +-180", "err +-720", "ms", "speedup");
+		auto libmMs = report("libm", [](float a) { return sinf(a * PI / 180.0f); }, 0.0);
+		report("table", FastTrig::tableSin, libmMs);
+		report("poly", FastTrig::polySin, libmMs);
+	}
+
+private:
+	template <typename Sin>
+	static double report(const char* name, Sin sin, double libmMs)
+	{
+		// Angles as sinDeg sees them: walking and spinning sample the whole circle
+		std::vector<float> angles(COUNT);
+		for (int i = 0; i < COUNT; ++i)
+			angles[i] = -180.0f + 360.0f * i / COUNT;
+
+		std::vector<float> results(COUNT);
+		auto ms = Bench::best([&]
+		{
+			for (int i = 0; i < COUNT; ++i)
+				results[i] = sin(angles[i]);
+			Bench::keep(results[COUNT / 3]);
+		});
+
+		printf("%-6s %12.2g %12.2g %10.2f", name, maxError(sin, 180.0f), maxError(sin, 720.0f), ms);
+		if (libmMs > 0.0) printf(" %7.1fx", libmMs / ms);
+		printf("\n");
+		return ms;
+	}
+
+	template <typename Sin>
+	static double maxError(Sin sin, float range)
+	{
+		auto error = 0.0;
+		for (int i = 0; i <= COUNT; ++i)
+		{
+			auto a = -range + 2.0f * range * i / COUNT;
+			error = (std::max)(error, fabs(sin(a) - ::sin(a * 3.14159265358979323846 / 180.0)));
+		}
+		return error;
+	}
+};
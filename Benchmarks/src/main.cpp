@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <string.h>
+#include "GpuBufferBench.h"
+#include "MatrixBench.h"
+#include "MeshBench.h"
+#include "RenderQueueBench.h"
+#include "TgaBench.h"
+#include "TransparencyBench.h"
+#include "TrigBench.h"
+
+// Micro-benchmarks behind the performance notes in common/. Runs them all,
+// or only those named on the command line, e.g.
+//   Benchmarks matrix
+// Arguments of the form name=value are options for the benchmarks that read
+// them, e.g.
+//   Benchmarks meshtext mb=1000
+// Timings only mean something in a Release build.
+int main(int argc, char** argv)
+{
+	struct Benchmark
+	{
+		const char* name;
+		void (*run)();
+	};
+	static const Benchmark benchmarks[] =
+	{
+		{ "matrix", MatrixBench::run },
+		{ "trig", TrigBench::run },
+		{ "gpubuffer", GpuBufferBench::run },
+		{ "mesh", MeshBench::run },
+		{ "meshtext", MeshBench::runText },
+		{ "renderqueue", RenderQueueBench::run },
+		{ "sorter", TransparencyBench::runSorter },
+		{ "oit", TransparencyBench::runOit },
+		{ "tga", TgaBench::run },
+	};
+
+	Bench::setArguments(argc, argv);
+	auto names = 0;
+	for (int i = 1; i < argc; ++i)
+		names += strchr(argv[i], '=') == NULL;
+
+	auto ran = 0;
+	for (auto& benchmark : benchmarks)
+	{
+		auto selected = names == 0;
+		for (int i = 1; i < argc; ++i)
+			selected = selected || strcmp(argv[i], benchmark.name) == 0;
+		if (!selected) continue;
+		benchmark.run();
+		++ran;
+	}
+
+	if (ran == 0)
+	{
+		fprintf(stderr, "usage: %s [name...] [option=value...], names:", argv[0]);
+		for (auto& benchmark : benchmarks)
+			fprintf(stderr, " %s", benchmark.name);
+		fprintf(stderr, "\n");
+		return 1;
+	}
+	return 0;
+}
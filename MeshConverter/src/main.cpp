@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <vector>
+#include <Mesh.h>
+#include <MeshOptimizer.h>
+
+// Converts the x y z u v text meshes (e.g. 05_SimpleCamera/data/world.txt)
+// to the binary format in Mesh.h, indexed and ordered for the vertex cache:
+//   MeshConverter world.txt world.mesh
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s <input.txt> <output.mesh>\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<float> soup;
+	if (!Mesh::loadText(argv[1], soup))
+	{
+		fprintf(stderr, "could not read %s\n", argv[1]);
+		return 1;
+	}
+
+	const uint32_t stride = sizeof(float) * 5;
+	const auto soupCount = soup.size() / 5;
+	std::vector<unsigned char> vertices;
+	std::vector<uint32_t> indices;
+	MeshOptimizer::deduplicate(soup.data(), soupCount, stride, vertices, indices);
+	const auto vertexCount = (uint32_t)(vertices.size() / stride);
+	const auto before = MeshOptimizer::acmr(indices.data(), indices.size(), vertexCount);
+	MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+	std::vector<unsigned char> ordered;
+	MeshOptimizer::optimizeVertexFetch(vertices.data(), vertexCount, stride, indices, ordered);
+	const auto after = MeshOptimizer::acmr(indices.data(), indices.size(), vertexCount);
+
+	const auto indexSize = MeshOptimizer::indexSize(vertexCount);
+	auto packed = MeshOptimizer::packIndices(indices, indexSize);
+	if (!Mesh::write(argv[2], ordered.data(), vertexCount, stride, Mesh::Position | Mesh::TexCoord,
+		packed.data(), (uint32_t)indices.size(), indexSize))
+	{
+		fprintf(stderr, "could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	printf("%s: %u triangles, %u of %u vertices unique, %u bit indices\n",
+		argv[2], (uint32_t)indices.size() / 3, vertexCount, (uint32_t)soupCount, indexSize * 8);
+	printf("ACMR (%d entry FIFO): %.3f unindexed, %.3f indexed, %.3f reordered\n",
+		MeshOptimizer::CACHE_SIZE, 3.0f, before, after);
+	return 0;
+}
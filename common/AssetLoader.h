@@ -0,0 +1,187 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <cassert>
+#include "LockFreeQueue.h"
+#include "Tga.h"
+#include "TextureAtlas.h"
+
+// Reads and decodes Tga files, or maps and packs them into a TextureAtlas, on
+// a pool of worker threads. Finished work comes back to the GL thread through
+// a lock-free queue and is handed out by poll(), which the App calls once per
+// frame, so the first frame never waits for file I/O, decoding or packing.
+class AssetLoader
+{
+public:
+	static const size_t QUEUE_SIZE = 256;
+
+private:
+	// One file to decode, or several to pack into an atlas when maxSize > 0
+	struct Job
+	{
+		int ticket;
+		std::vector<std::string> files;
+		int maxSize;
+	};
+
+	// Either image or atlas is set
+	struct Result
+	{
+		int ticket;
+		std::unique_ptr<Tga> image;
+		std::unique_ptr<TextureAtlas> atlas;
+	};
+
+	LockFreeQueue<Job> m_jobs;
+	LockFreeQueue<Result> m_results;
+	std::vector<std::thread> m_workers;
+
+	// Only for idle workers to sleep on; the queues themselves take no lock
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::atomic<int> m_queued;
+	bool m_stop;
+
+	// GL thread only
+	int m_issued, m_completed;
+
+	AssetLoader(const AssetLoader&);
+	AssetLoader& operator = (const AssetLoader&);
+
+public:
+	// threads 0 uses one worker per core, leaving one for the GL thread
+	AssetLoader(int threads = 0) : m_jobs(QUEUE_SIZE), m_results(QUEUE_SIZE), m_queued(0), m_stop(false),
+		m_issued(0), m_completed(0)
+	{
+		if (threads <= 0)
+			threads = (std::max)((int)std::thread::hardware_concurrency() - 1, 1);
+		for (int i = 0; i < threads; ++i)
+			m_workers.emplace_back([this] { work(); });
+	}
+
+	~AssetLoader()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for (auto& worker : m_workers)
+			worker.join();
+	}
+
+	// Queues file for decoding and returns the ticket poll() reports it under.
+	int load(const char* file)
+	{
+		return queue(std::vector<std::string>(1, file), 0);
+	}
+
+	// Queues files to be mapped and packed into one atlas of at most
+	// maxSize x maxSize, sprite i being files[i]. The worker composes the
+	// atlas too, so only TextureAtlas::upload() is left for the GL thread.
+	int loadAtlas(const std::vector<std::string>& files, int maxSize)
+	{
+		assert(!files.empty() && maxSize > 0);
+		return queue(files, maxSize);
+	}
+
+	// Hands up to maxResults finished images to onLoaded(ticket, const Tga&)
+	// and atlases to onAtlas(ticket, TextureAtlas&); an atlas whose width()
+	// is 0 did not fit. Call on the GL thread.
+	template <typename Callback, typename AtlasCallback>
+	int poll(Callback onLoaded, AtlasCallback onAtlas, int maxResults = QUEUE_SIZE)
+	{
+		int count = 0;
+		Result result;
+		while (count < maxResults && m_results.pop(result))
+		{
+			if (result.atlas)
+				onAtlas(result.ticket, *result.atlas);
+			else
+				onLoaded(result.ticket, *result.image);
+			result.image.reset();
+			result.atlas.reset();
+			++m_completed;
+			++count;
+		}
+		return count;
+	}
+
+	template <typename Callback>
+	int poll(Callback onLoaded)
+	{
+		return poll(onLoaded, [](int, TextureAtlas&) { });
+	}
+
+	int poll()
+	{
+		return poll([](int, const Tga&) { });
+	}
+
+	int pending() const { return m_issued - m_completed; }
+
+	// A 1x1 mid gray texture
+	static void placeholder(GLuint texture)
+	{
+		static const unsigned char gray[] = { 128, 128, 128 };
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, gray);
+	}
+
+private:
+	int queue(const std::vector<std::string>& files, int maxSize)
+	{
+		auto ticket = m_issued++;
+		Job job = { ticket, files, maxSize };
+		while (!m_jobs.push(std::move(job)))
+			std::this_thread::yield();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_queued;
+		}
+		m_wake.notify_one();
+		return ticket;
+	}
+
+	void work()
+	{
+		for (;;)
+		{
+			Job job;
+			if (m_jobs.pop(job))
+			{
+				--m_queued;
+				Result result;
+				result.ticket = job.ticket;
+				if (job.maxSize > 0)
+				{
+					result.atlas.reset(new TextureAtlas());
+					for (auto& file : job.files)
+						result.atlas->add(file.c_str());
+					result.atlas->pack(job.maxSize);
+				}
+				else
+				{
+					result.image.reset(new Tga(job.files[0].c_str()));
+				}
+				while (!m_results.push(std::move(result)))
+					std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_stop || m_queued > 0; });
+			if (m_stop) return;
+		}
+	}
+};
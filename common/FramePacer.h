@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+// Paces a frame loop on std::chrono::steady_clock and keeps the last
+// HISTORY frame times for percentile reports.
+//
+// Deadlines advance by exactly 1/fps from the previous deadline, so rounding
+// does not accumulate: 60 fps lands on 60, not the 62-64 an integer
+// millisecond frame time gives. Waiting sleeps until SPIN_MARGIN before the
+// deadline and spins the rest, because OS sleeps overshoot by up to a
+// scheduler tick. fps <= 0 runs uncapped.
+class FramePacer
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	static const int HISTORY = 4096;
+
+private:
+	Clock::duration m_frameTime;
+	Clock::time_point m_deadline;
+	Clock::time_point m_last;
+	bool m_started;
+
+	std::vector<float> m_history;
+	int m_count;
+
+public:
+	FramePacer(int fps = 0) : m_started(false), m_history(HISTORY), m_count(0)
+	{
+		setFps(fps);
+	}
+
+	void setFps(int fps)
+	{
+		m_frameTime = fps > 0
+			? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps))
+			: Clock::duration::zero();
+	}
+
+	// Blocks until the next frame is due and records the time since the
+	// previous call.
+	void wait()
+	{
+		auto now = Clock::now();
+		if (!m_started)
+		{
+			m_started = true;
+			m_deadline = m_last = now;
+			return;
+		}
+
+		if (m_frameTime > Clock::duration::zero())
+		{
+			m_deadline += m_frameTime;
+			// More than a frame behind: start over rather than rushing to catch up.
+			if (now > m_deadline + m_frameTime)
+				m_deadline = now;
+
+			const auto SPIN_MARGIN = std::chrono::milliseconds(2);
+			if (m_deadline - now > SPIN_MARGIN)
+				std::this_thread::sleep_for(m_deadline - now - SPIN_MARGIN);
+			while (Clock::now() < m_deadline)
+				std::this_thread::yield();
+			now = Clock::now();
+		}
+
+		m_history[m_count % HISTORY] = std::chrono::duration<float, std::milli>(now - m_last).count();
+		++m_count;
+		m_last = now;
+	}
+
+	int frames() const { return m_count; }
+
+	// Frame time in milliseconds at percentile p (0..100) over the recorded
+	// frames, or 0 before the second frame.
+	float percentile(float p) const
+	{
+		// std::min takes references, and HISTORY has no out-of-line definition
+		const int history = HISTORY;
+		const auto n = (std::min)(m_count, history);
+		if (n == 0) return 0.0f;
+		std::vector<float> sorted(m_history.begin(), m_history.begin() + n);
+		auto k = (std::min)(n - 1, (int)(p / 100.0f * n));
+		std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+		return sorted[k];
+	}
+
+	void report(FILE* out = stdout) const
+	{
+		if (m_count == 0) return;
+		const auto p50 = percentile(50.0f);
+		fprintf(out, "frames: %d, %.1f fps at median, frame time ms p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+			m_count, p50 > 0.0f ? 1000.0f / p50 : 0.0f, p50, percentile(90.0f), percentile(99.0f), percentile(100.0f));
+	}
+};
+
+// Fixed-timestep simulation driven by wall-clock time. Each frame, run
+// update() advance() times, then render with alpha() to interpolate between
+// the previous and the current simulation state:
+//
+//	for (auto steps = m_timestep.advance(); steps > 0; --steps) update();
+//	render(m_timestep.alpha());
+class FixedTimestep
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+private:
+	Clock::duration m_step;
+	Clock::duration m_accumulator;
+	Clock::time_point m_last;
+	int m_maxSteps;
+	bool m_started;
+
+public:
+	// maxSteps bounds the catch-up after a stall, so a slow frame cannot
+	// trigger ever more simulation steps.
+	FixedTimestep(int stepsPerSecond, int maxSteps = 5) :
+		m_step(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / stepsPerSecond))),
+		m_accumulator(Clock::duration::zero()), m_maxSteps(maxSteps), m_started(false)
+	{
+	}
+
+	// Number of simulation steps due since the previous call.
+	int advance()
+	{
+		const auto now = Clock::now();
+		if (!m_started)
+		{
+			m_started = true;
+			m_last = now;
+			return 1;
+		}
+		m_accumulator += now - m_last;
+		m_last = now;
+
+		auto steps = 0;
+		while (m_accumulator >= m_step && steps < m_maxSteps)
+		{
+			m_accumulator -= m_step;
+			++steps;
+		}
+		if (steps == m_maxSteps && m_accumulator >= m_step)
+			m_accumulator = Clock::duration::zero();
+		return steps;
+	}
+
+	// How far the current time is between the last step and the next one, 0..1.
+	float alpha() const
+	{
+		return std::chrono::duration<float>(m_accumulator).count() / std::chrono::duration<float>(m_step).count();
+	}
+};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <cassert>
+
+// Shadows the GL state a frame keeps setting: bound program, buffers and
+// textures, the common enable caps, blend, depth and cull settings and the
+// viewport. A call that would set what is already set never reaches the
+// driver, so render() can state everything it needs each frame without
+// paying for it. Counts issued and filtered calls per frame.
+//
+// Starts out knowing nothing, so the first call of each kind always goes
+// through. Call invalidate() after code that changes state behind the
+// cache's back, such as GpuBuffer::upload() or Texture::upload().
+class GlStateCache
+{
+public:
+	static const int MAX_TEXTURE_UNITS = 8;
+
+	struct Counters
+	{
+		int issued;
+		int filtered;
+	};
+
+private:
+	// Shadowed glEnable caps, see index()
+	enum Cap { Blend, DepthTest, CullFace, ScissorTest, StencilTest, CAP_COUNT };
+
+	// Not a valid value of any shadowed state
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+	GLuint m_program;
+	GLuint m_arrayBuffer, m_elementBuffer;
+	GLenum m_activeTexture;
+	GLuint m_texture2d[MAX_TEXTURE_UNITS], m_textureCube[MAX_TEXTURE_UNITS];
+	GLuint m_caps[CAP_COUNT];
+	GLenum m_blendSource, m_blendDestination;
+	GLenum m_depthFunc, m_cullFace;
+	GLuint m_depthMask;
+	GLint m_viewport[4];
+	bool m_viewportKnown;
+
+	Counters m_frame, m_lastFrame, m_total;
+	int m_frames;
+
+	GlStateCache(const GlStateCache&);
+	GlStateCache& operator = (const GlStateCache&);
+
+public:
+	GlStateCache()
+	{
+		invalidate();
+		m_frame = m_lastFrame = m_total = { 0, 0 };
+		m_frames = 0;
+	}
+
+	// Forgets all shadowed state; the next call of each kind is issued
+	void invalidate()
+	{
+		m_program = m_arrayBuffer = m_elementBuffer = UNKNOWN;
+		m_activeTexture = UNKNOWN;
+		for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+			m_texture2d[i] = m_textureCube[i] = UNKNOWN;
+		for (int i = 0; i < CAP_COUNT; ++i)
+			m_caps[i] = UNKNOWN;
+		m_blendSource = m_blendDestination = UNKNOWN;
+		m_depthFunc = m_cullFace = UNKNOWN;
+		m_depthMask = UNKNOWN;
+		m_viewportKnown = false;
+	}
+
+	void useProgram(GLuint program)
+	{
+		if (filter(m_program == program)) return;
+		m_program = program;
+		glUseProgram(program);
+	}
+
+	void bindBuffer(GLenum target, GLuint buffer)
+	{
+		auto& bound = target == GL_ELEMENT_ARRAY_BUFFER ? m_elementBuffer : m_arrayBuffer;
+		if (filter(bound == buffer)) return;
+		bound = buffer;
+		glBindBuffer(target, buffer);
+	}
+
+	void activeTexture(GLenum unit)
+	{
+		assert(unit >= GL_TEXTURE0 && unit < GL_TEXTURE0 + MAX_TEXTURE_UNITS);
+		if (filter(m_activeTexture == unit)) return;
+		m_activeTexture = unit;
+		glActiveTexture(unit);
+	}
+
+	// Binds to the active unit; call activeTexture() first
+	void bindTexture(GLenum target, GLuint texture)
+	{
+		assert(m_activeTexture != UNKNOWN);
+		auto unit = m_activeTexture - GL_TEXTURE0;
+		auto& bound = target == GL_TEXTURE_CUBE_MAP ? m_textureCube[unit] : m_texture2d[unit];
+		if (filter(bound == texture)) return;
+		bound = texture;
+		glBindTexture(target, texture);
+	}
+
+	void enable(GLenum cap, bool enabled)
+	{
+		auto& state = m_caps[index(cap)];
+		if (filter(state == (GLuint)enabled)) return;
+		state = enabled;
+		if (enabled) glEnable(cap);
+		else glDisable(cap);
+	}
+
+	void blendFunc(GLenum source, GLenum destination)
+	{
+		if (filter(m_blendSource == source && m_blendDestination == destination)) return;
+		m_blendSource = source;
+		m_blendDestination = destination;
+		glBlendFunc(source, destination);
+	}
+
+	void depthFunc(GLenum func)
+	{
+		if (filter(m_depthFunc == func)) return;
+		m_depthFunc = func;
+		glDepthFunc(func);
+	}
+
+	void depthMask(bool write)
+	{
+		if (filter(m_depthMask == (GLuint)write)) return;
+		m_depthMask = write;
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+
+	void cullFace(GLenum face)
+	{
+		if (filter(m_cullFace == face)) return;
+		m_cullFace = face;
+		glCullFace(face);
+	}
+
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (filter(m_viewportKnown && m_viewport[0] == x && m_viewport[1] == y && m_viewport[2] == width && m_viewport[3] == height)) return;
+		m_viewport[0] = x;
+		m_viewport[1] = y;
+		m_viewport[2] = width;
+		m_viewport[3] = height;
+		m_viewportKnown = true;
+		glViewport(x, y, width, height);
+	}
+
+	// Closes the frame's counters; lastFrame() then reports them
+	void endFrame()
+	{
+		m_lastFrame = m_frame;
+		m_frame = { 0, 0 };
+		++m_frames;
+	}
+
+	const Counters& lastFrame() const { return m_lastFrame; }
+	const Counters& total() const { return m_total; }
+	int frames() const { return m_frames; }
+
+private:
+	// Counts the call and returns same, true when it can be skipped
+	bool filter(bool same)
+	{
+		if (same)
+		{
+			++m_frame.filtered;
+			++m_total.filtered;
+		}
+		else
+		{
+			++m_frame.issued;
+			++m_total.issued;
+		}
+		return same;
+	}
+
+	static int index(GLenum cap)
+	{
+		switch (cap)
+		{
+		case GL_BLEND: return Blend;
+		case GL_DEPTH_TEST: return DepthTest;
+		case GL_CULL_FACE: return CullFace;
+		case GL_SCISSOR_TEST: return ScissorTest;
+		case GL_STENCIL_TEST: return StencilTest;
+		default: assert(!"cap is not shadowed"); return Blend;
+		}
+	}
+};
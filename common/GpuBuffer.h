@@ -0,0 +1,61 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <stdint.h>
+
+// A GL buffer object holding vertex (GL_ARRAY_BUFFER) or index
+// (GL_ELEMENT_ARRAY_BUFFER) data. Uploaded once, it lets draws read from GPU
+// memory instead of having the driver copy client arrays on every call.
+// After upload() the buffer stays bound, so glVertexAttribPointer and
+// glDrawElements take byte offsets into it (see offset()) instead of pointers.
+// "Benchmarks gpubuffer" times the two against each other.
+class GpuBuffer
+{
+private:
+	GLenum m_target;
+	GLuint m_buffer;
+	GLsizeiptr m_size;
+
+	GpuBuffer(const GpuBuffer&);
+	GpuBuffer& operator = (const GpuBuffer&);
+
+public:
+	GpuBuffer() : m_target(GL_ARRAY_BUFFER), m_buffer(0), m_size(0) { }
+
+	~GpuBuffer()
+	{
+		if (m_buffer) glDeleteBuffers(1, &m_buffer);
+	}
+
+	// Replaces the whole contents; usage is GL_STATIC_DRAW for data written
+	// once, GL_DYNAMIC_DRAW or GL_STREAM_DRAW for data rewritten per frame.
+	void upload(GLenum target, const void* data, GLsizeiptr size, GLenum usage = GL_STATIC_DRAW)
+	{
+		if (!m_buffer) glGenBuffers(1, &m_buffer);
+		m_target = target;
+		m_size = size;
+		glBindBuffer(m_target, m_buffer);
+		glBufferData(m_target, size, data, usage);
+	}
+
+	// Rewrites part of the contents without reallocating.
+	void update(const void* data, GLsizeiptr size, GLintptr offset = 0)
+	{
+		glBindBuffer(m_target, m_buffer);
+		glBufferSubData(m_target, offset, size, data);
+	}
+
+	void bind() const
+	{
+		glBindBuffer(m_target, m_buffer);
+	}
+
+	GLuint id() const { return m_buffer; }
+	GLsizeiptr size() const { return m_size; }
+
+	// A byte offset into the bound buffer, in the form the GL pointer arguments take.
+	static const void* offset(size_t bytes)
+	{
+		return (const void*)(uintptr_t)bytes;
+	}
+};
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include "Utils.h"
+#include "Window.h"
 #include <cassert>
+#include <stdint.h>
 #include <stdio.h>
 
 class Graphic
@@ -11,22 +16,149 @@ private:
 	EGLDisplay m_display;
 	EGLSurface m_surface;
 	EGLContext m_context;
+	bool m_headless;
+
+	// Only used by a surfaceless context, which has no default framebuffer.
+	GLuint m_framebuffer;
+	GLuint m_colorRenderbuffer;
+	GLuint m_depthRenderbuffer;
 
 public:
-	Graphic(void* nativeSurface)
+	Graphic(void* nativeSurface) : m_headless(false), m_framebuffer(0), m_colorRenderbuffer(0), m_depthRenderbuffer(0)
+	{
+		createOnWindow(EGL_DEFAULT_DISPLAY, nativeSurface);
+	}
+
+	// Renders into window, or headless at the window's size when it has no
+	// native surface (NullWindow).
+	Graphic(Window& window) : m_headless(window.surface() == NULL), m_framebuffer(0), m_colorRenderbuffer(0), m_depthRenderbuffer(0)
+	{
+		if (m_headless)
+			createOffscreen(window.width(), window.height());
+		else if (window.display())
+			createOnWindow((EGLNativeDisplayType)(intptr_t)window.display(), window.surface());
+		else
+			createOnWindow(EGL_DEFAULT_DISPLAY, window.surface());
+	}
+
+	// Offscreen rendering without a window, e.g. on a headless Linux server with
+	// Mesa llvmpipe. Uses the EGL_MESA_platform_surfaceless display when the
+	// client supports it, then a width x height pbuffer, or a surfaceless context
+	// rendering into a framebuffer object if the display has no pbuffer configs.
+	// There is no vsync: swapBuffers() only flushes.
+	Graphic(int width, int height) : m_headless(true), m_framebuffer(0), m_colorRenderbuffer(0), m_depthRenderbuffer(0)
+	{
+		createOffscreen(width, height);
+	}
+
+	~Graphic()
+	{
+		if (m_framebuffer)
+		{
+			glDeleteFramebuffers(1, &m_framebuffer);
+			glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+			glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+		}
+		eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(m_display, m_context);
+		if (m_surface != EGL_NO_SURFACE) eglDestroySurface(m_display, m_surface);
+		eglTerminate(m_display);
+	}
+
+	bool headless() const { return m_headless; }
+
+	void makeCurrent()
+	{
+		auto okay = eglMakeCurrent(m_display, m_surface, m_surface, m_context);
+		assert(okay);
+	}
+
+	void swapBuffers()
+	{
+		if (m_headless)
+		{
+			glFlush();
+			return;
+		}
+		auto okay = eglSwapBuffers(m_display, m_surface);
+		assert(okay);
+	}
+
+private:
+	void createOnWindow(EGLNativeDisplayType nativeDisplay, void* nativeSurface)
+	{
+		m_display = eglGetDisplay(nativeDisplay);
+		assert(m_display != EGL_NO_DISPLAY);
+		initialize();
+
+		auto config = chooseConfig(EGL_WINDOW_BIT);
+		assert(config);
+
+		m_surface = eglCreateWindowSurface(m_display, config, (EGLNativeWindowType)nativeSurface, NULL);
+		assert(m_surface != EGL_NO_SURFACE);
+
+		createContext(config);
+	}
+
+	void createOffscreen(int width, int height)
 	{
-		m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		m_display = EGL_NO_DISPLAY;
+		if (Utils::hasExtension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless"))
+		{
+			auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+			if (getPlatformDisplay)
+				m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+		if (m_display == EGL_NO_DISPLAY)
+			m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
 		assert(m_display != EGL_NO_DISPLAY);
+		initialize();
+
+		m_surface = EGL_NO_SURFACE;
+		auto config = chooseConfig(EGL_PBUFFER_BIT);
+		if (config)
+		{
+			EGLint pbufferAttributes[] =
+			{
+				EGL_WIDTH, width,
+				EGL_HEIGHT, height,
+				EGL_NONE
+			};
+			m_surface = eglCreatePbufferSurface(m_display, config, pbufferAttributes);
+			assert(m_surface != EGL_NO_SURFACE);
+		}
+		else
+		{
+			assert(Utils::hasExtension(eglQueryString(m_display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"));
+			config = chooseConfig(0);
+			assert(config);
+		}
+
+		createContext(config);
 
+		if (m_surface == EGL_NO_SURFACE)
+			createFramebuffer(width, height);
+	}
+
+	void initialize()
+	{
 		EGLint majorVersion, minorVersion;
 		auto okay = eglInitialize(m_display, &majorVersion, &minorVersion);
 		assert(okay);
 		printf("EGL_VERSION: %d.%d\n", majorVersion, minorVersion);
 
+		okay = eglBindAPI(EGL_OPENGL_ES_API);
+		assert(okay);
+	}
+
+	// surfaceType 0 accepts any config, as needed by a surfaceless context.
+	// Returns NULL when nothing matches.
+	EGLConfig chooseConfig(EGLint surfaceType)
+	{
 		EGLint attributes[] =
 		{
 			EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
-			EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+			EGL_SURFACE_TYPE, surfaceType,
 			EGL_RED_SIZE, 8,
 			EGL_GREEN_SIZE, 8,
 			EGL_BLUE_SIZE, 8,
@@ -35,14 +167,14 @@ public:
 			EGL_STENCIL_SIZE, 8,
 			EGL_NONE
 		};
-		EGLConfig config;
-		EGLint numConfigs;
-		okay = eglChooseConfig(m_display, attributes, &config, 1, &numConfigs);
-		assert(okay);
-
-		m_surface = eglCreateWindowSurface(m_display, config, (EGLNativeWindowType)nativeSurface, NULL);
-		assert(m_surface != EGL_NO_SURFACE);
+		EGLConfig config = NULL;
+		EGLint numConfigs = 0;
+		auto okay = eglChooseConfig(m_display, attributes, &config, 1, &numConfigs);
+		return okay && numConfigs > 0 ? config : NULL;
+	}
 
+	void createContext(EGLConfig config)
+	{
 		EGLint contextAttributes[] =
 		{
 			EGL_CONTEXT_MAJOR_VERSION, 2,
@@ -61,19 +193,31 @@ public:
 		printGLString("GL_EXTENSIONS", GL_EXTENSIONS);
 	}
 
-	void makeCurrent()
+	// Stands in for the default framebuffer, so Apps render unchanged.
+	void createFramebuffer(int width, int height)
 	{
-		auto okay = eglMakeCurrent(m_display, m_surface, m_surface, m_context);
-		assert(okay);
-	}
+		auto colorFormat = Utils::hasExtension("GL_OES_rgb8_rgba8") ? GL_RGBA8_OES : GL_RGBA4;
+		auto packedDepthStencil = Utils::hasExtension("GL_OES_packed_depth_stencil");
 
-	void swapBuffers()
-	{
-		auto okay = eglSwapBuffers(m_display, m_surface);
-		assert(okay);
+		glGenRenderbuffers(1, &m_colorRenderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_colorRenderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, colorFormat, width, height);
+
+		glGenRenderbuffers(1, &m_depthRenderbuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, packedDepthStencil ? GL_DEPTH24_STENCIL8_OES : GL_DEPTH_COMPONENT16, width, height);
+
+		glGenFramebuffers(1, &m_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorRenderbuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+		if (packedDepthStencil)
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+
+		auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		assert(status == GL_FRAMEBUFFER_COMPLETE);
 	}
 
-private:
 	void printGLString(const char* name, GLenum s)
 	{
 		const char* v = (const char*)glGetString(s);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+
+// Bounded multi-producer multi-consumer queue (Vyukov's algorithm). Each cell
+// carries a sequence number telling producers and consumers whose turn it is,
+// so push and pop only contend on one compare-exchange and never block.
+// T must be default constructible and move assignable.
+template <typename T>
+class LockFreeQueue
+{
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	// Keeps producers and consumers off each other's cache lines
+	static const size_t CACHE_LINE = 64;
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask;
+	char m_padding0[CACHE_LINE];
+	std::atomic<size_t> m_tail;
+	char m_padding1[CACHE_LINE];
+	std::atomic<size_t> m_head;
+	char m_padding2[CACHE_LINE];
+
+	LockFreeQueue(const LockFreeQueue&);
+	LockFreeQueue& operator = (const LockFreeQueue&);
+
+public:
+	// capacity is rounded up to a power of two
+	LockFreeQueue(size_t capacity) : m_tail(0), m_head(0)
+	{
+		size_t size = 2;
+		while (size < capacity) size *= 2;
+		m_cells.reset(new Cell[size]);
+		m_mask = size - 1;
+		for (size_t i = 0; i < size; ++i)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// Returns false when the queue is full
+	bool push(T&& value)
+	{
+		auto position = m_tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			auto& cell = m_cells[position & m_mask];
+			auto sequence = cell.sequence.load(std::memory_order_acquire);
+			auto difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+			if (difference == 0)
+			{
+				if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+				return false;
+			else
+				position = m_tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Returns false when the queue is empty
+	bool pop(T& value)
+	{
+		auto position = m_head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			auto& cell = m_cells[position & m_mask];
+			auto sequence = cell.sequence.load(std::memory_order_acquire);
+			auto difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+			if (difference == 0)
+			{
+				if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					value = std::move(cell.value);
+					cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+				return false;
+			else
+				position = m_head.load(std::memory_order_relaxed);
+		}
+	}
+};
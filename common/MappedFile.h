@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A read-only memory mapping of a whole file. Reads go straight to the page
+// cache, with no stdio buffering and no copy into a heap allocation.
+class MappedFile
+{
+private:
+	const unsigned char* m_data;
+	size_t m_size;
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#endif
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator = (const MappedFile&);
+
+public:
+	MappedFile(const char* filePath) : m_data(NULL), m_size(0)
+	{
+#ifdef _WIN32
+		m_mapping = NULL;
+		m_file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (m_file == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) return;
+		m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!m_mapping) return;
+		m_data = (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (m_data) m_size = (size_t)size.QuadPart;
+#else
+		int file = open(filePath, O_RDONLY);
+		if (file < 0) return;
+
+		struct stat info;
+		if (fstat(file, &info) == 0 && info.st_size > 0)
+		{
+			void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (data != MAP_FAILED)
+			{
+				m_data = (const unsigned char*)data;
+				m_size = (size_t)info.st_size;
+			}
+		}
+		// The mapping keeps its own reference to the file
+		close(file);
+#endif
+	}
+
+	MappedFile(MappedFile&& other) : m_data(other.m_data), m_size(other.m_size)
+	{
+#ifdef _WIN32
+		m_file = other.m_file;
+		m_mapping = other.m_mapping;
+		other.m_file = INVALID_HANDLE_VALUE;
+		other.m_mapping = NULL;
+#endif
+		other.m_data = NULL;
+		other.m_size = 0;
+	}
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+		if (m_data) munmap((void*)m_data, m_size);
+#endif
+	}
+
+	bool okay() const { return m_data != NULL; }
+	const unsigned char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+};
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <charconv>
+#include "MappedFile.h"
+
+// A binary mesh container, read in place from a memory mapping:
+//   MeshHeader                 48 bytes
+//   vertices                   vertexCount * vertexStride bytes, interleaved
+//   indices                    indexCount * indexSize bytes, may be empty
+// Both blobs start on ALIGNMENT byte boundaries and everything is little
+// endian, so a mapped file can go straight to glBufferData. "Benchmarks
+// mesh" times loading one against parsing the same vertices as text.
+struct MeshHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t vertexStride;
+	uint32_t attributes;
+	uint32_t indexCount;
+	uint32_t indexSize;
+	uint32_t reserved;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+};
+
+class Mesh
+{
+public:
+	static const uint32_t VERSION = 1;
+	static const size_t ALIGNMENT = 16;
+
+	// Bits of MeshHeader::attributes, stored in this order in each vertex
+	enum Attribute
+	{
+		Position = 1,  // 3 floats
+		TexCoord = 2,  // 2 floats
+	};
+
+	enum Status
+	{
+		Okay,
+		CouldNotOpenFile,
+		InvalidFormat,
+		UnsupportedVersion,
+		TruncatedFile
+	};
+
+private:
+	MappedFile m_file;
+	MeshHeader m_header;
+	Status m_status;
+
+public:
+	Mesh(const char* filePath) : m_file(filePath)
+	{
+		memset(&m_header, 0, sizeof(m_header));
+		if (!m_file.okay()) { m_status = CouldNotOpenFile; return; }
+		if (m_file.size() < sizeof(MeshHeader)) { m_status = TruncatedFile; return; }
+		memcpy(&m_header, m_file.data(), sizeof(m_header));
+		m_status = validate(m_header, m_file.size());
+	}
+
+	bool okay() const { return m_status == Okay; }
+	Status status() const { return m_status; }
+	uint32_t version() const { return m_header.version; }
+	uint32_t attributes() const { return m_header.attributes; }
+	uint32_t vertexCount() const { return m_header.vertexCount; }
+	uint32_t vertexStride() const { return m_header.vertexStride; }
+	uint32_t indexCount() const { return m_header.indexCount; }
+	uint32_t indexSize() const { return m_header.indexSize; }
+	const void* vertices() const { return m_file.data() + m_header.vertexOffset; }
+	const void* indices() const { return m_header.indexCount ? m_file.data() + m_header.indexOffset : NULL; }
+	size_t vertexBytes() const { return (size_t)m_header.vertexCount * m_header.vertexStride; }
+	size_t indexBytes() const { return (size_t)m_header.indexCount * m_header.indexSize; }
+
+	static Status validate(const MeshHeader& header, size_t fileSize)
+	{
+		if (memcmp(header.magic, "MESH", 4) != 0) return InvalidFormat;
+		if (header.version != VERSION) return UnsupportedVersion;
+		if (header.vertexStride == 0 || header.vertexOffset % ALIGNMENT || header.indexOffset % ALIGNMENT) return InvalidFormat;
+		if (header.indexCount && header.indexSize != 1 && header.indexSize != 2 && header.indexSize != 4) return InvalidFormat;
+		if (header.vertexOffset + (uint64_t)header.vertexCount * header.vertexStride > fileSize) return TruncatedFile;
+		if (header.indexOffset + (uint64_t)header.indexCount * header.indexSize > fileSize) return TruncatedFile;
+		return Okay;
+	}
+
+	static size_t align(size_t offset)
+	{
+		return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	}
+
+	// Writes a mesh file; indices may be NULL with indexCount 0.
+	static bool write(const char* filePath, const void* vertices, uint32_t vertexCount, uint32_t vertexStride, uint32_t attributes,
+		const void* indices = NULL, uint32_t indexCount = 0, uint32_t indexSize = 0)
+	{
+		MeshHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "MESH", 4);
+		header.version = VERSION;
+		header.vertexCount = vertexCount;
+		header.vertexStride = vertexStride;
+		header.attributes = attributes;
+		header.indexCount = indexCount;
+		header.indexSize = indexCount ? indexSize : 0;
+		header.vertexOffset = align(sizeof(MeshHeader));
+		header.indexOffset = align(header.vertexOffset + (uint64_t)vertexCount * vertexStride);
+
+		FILE* file = fopen(filePath, "wb");
+		if (!file) return false;
+		static const char zeros[ALIGNMENT] = {};
+		auto okay = fwrite(&header, sizeof(header), 1, file) == 1;
+		okay = okay && fwrite(zeros, 1, header.vertexOffset - sizeof(header), file) == header.vertexOffset - sizeof(header);
+		okay = okay && fwrite(vertices, vertexStride, vertexCount, file) == vertexCount;
+		if (indexCount)
+		{
+			auto padding = header.indexOffset - (header.vertexOffset + (uint64_t)vertexCount * vertexStride);
+			okay = okay && fwrite(zeros, 1, padding, file) == padding;
+			okay = okay && fwrite(indices, indexSize, indexCount, file) == indexCount;
+		}
+		return fclose(file) == 0 && okay;
+	}
+
+	// Reads the text format: a triangle count, then x y z u v for each vertex,
+	// separated by any whitespace. The file is mapped and split into line
+	// aligned chunks that are parsed in parallel with std::from_chars.
+	// threads 0 uses one per core, for files big enough to be worth it.
+	// "Benchmarks meshtext" times it against the fscanf loop it replaced.
+	static bool loadText(const char* filePath, std::vector<float>& vertices, int threads = 0)
+	{
+		MappedFile file(filePath);
+		if (!file.okay()) return false;
+		auto end = (const char*)file.data() + file.size();
+		auto begin = skipSpace((const char*)file.data(), end);
+
+		int numTriangles;
+		auto result = std::from_chars(begin, end, numTriangles);
+		if (result.ec != std::errc() || numTriangles < 0) return false;
+		begin = result.ptr;
+		const size_t count = (size_t)numTriangles * 3 * 5;
+
+		const size_t MIN_CHUNK = 1 << 20;
+		if (threads <= 0)
+			threads = (int)(std::min)((size_t)(std::max)(std::thread::hardware_concurrency(), 1u), (size_t)(end - begin) / MIN_CHUNK + 1);
+
+		// Chunk i covers [bounds[i], bounds[i + 1]), each bound moved past a newline
+		std::vector<const char*> bounds(threads + 1);
+		bounds[0] = begin;
+		bounds[threads] = end;
+		for (int i = 1; i < threads; ++i)
+		{
+			auto p = (std::max)(begin + (end - begin) * i / threads, bounds[i - 1]);
+			p = (const char*)memchr(p, '\n', end - p);
+			bounds[i] = p ? p + 1 : end;
+		}
+
+		std::vector<std::vector<float>> chunks(threads);
+		std::unique_ptr<bool[]> okay(new bool[threads]);
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; ++i)
+			workers.emplace_back([&, i] { okay[i] = parseFloats(bounds[i], bounds[i + 1], chunks[i]); });
+		okay[0] = parseFloats(bounds[0], bounds[1], chunks[0]);
+		for (auto& worker : workers)
+			worker.join();
+
+		vertices.resize(count);
+		size_t filled = 0;
+		for (int i = 0; i < threads && filled < count; ++i)
+		{
+			if (!okay[i]) return false;
+			auto n = (std::min)(chunks[i].size(), count - filled);
+			memcpy(vertices.data() + filled, chunks[i].data(), n * sizeof(float));
+			filled += n;
+		}
+		return filled == count;
+	}
+
+private:
+	static const char* skipSpace(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+		return p;
+	}
+
+	static bool parseFloats(const char* p, const char* end, std::vector<float>& out)
+	{
+		out.reserve((end - p) / 8);
+		for (;;)
+		{
+			p = skipSpace(p, end);
+			if (p == end) return true;
+			// from_chars, unlike scanf, takes no leading plus
+			if (*p == '+') ++p;
+			float value;
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc()) return false;
+			out.push_back(value);
+			p = result.ptr;
+		}
+	}
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+// Turns triangle soup into an indexed mesh a post-transform vertex cache can
+// make use of: identical vertices are merged, triangles are reordered with
+// Tipsify (Sander, Nehab and Barczak 2007), and vertices are laid out in the
+// order the new index buffer first reads them.
+class MeshOptimizer
+{
+public:
+	// A typical size for the FIFO post-transform cache of GLES 2.0 hardware
+	static const int CACHE_SIZE = 16;
+
+	// vertices holds count vertices of stride bytes each, every three a triangle.
+	// Fills outVertices with the unique vertices and indices with three per triangle.
+	static void optimize(const void* vertices, size_t count, size_t stride,
+		std::vector<unsigned char>& outVertices, std::vector<uint32_t>& indices, int cacheSize = CACHE_SIZE)
+	{
+		std::vector<unsigned char> unique;
+		deduplicate(vertices, count, stride, unique, indices);
+		const size_t vertexCount = unique.size() / stride;
+		optimizeVertexCache(indices, vertexCount, cacheSize);
+		optimizeVertexFetch(unique.data(), vertexCount, stride, indices, outVertices);
+	}
+
+	// Merges vertices with identical bytes through an open addressing hash table
+	static void deduplicate(const void* vertices, size_t count, size_t stride,
+		std::vector<unsigned char>& outVertices, std::vector<uint32_t>& indices)
+	{
+		const uint32_t EMPTY = ~0u;
+		size_t tableSize = 16;
+		while (tableSize < count * 2) tableSize *= 2;
+		std::vector<uint32_t> table(tableSize, EMPTY);
+
+		auto src = (const unsigned char*)vertices;
+		outVertices.clear();
+		outVertices.reserve(count * stride);
+		indices.resize(count);
+		uint32_t uniqueCount = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto vertex = src + i * stride;
+			auto slot = hash(vertex, stride) & (tableSize - 1);
+			while (table[slot] != EMPTY && memcmp(outVertices.data() + table[slot] * stride, vertex, stride) != 0)
+				slot = (slot + 1) & (tableSize - 1);
+
+			if (table[slot] == EMPTY)
+			{
+				table[slot] = uniqueCount++;
+				outVertices.insert(outVertices.end(), vertex, vertex + stride);
+			}
+			indices[i] = table[slot];
+		}
+	}
+
+	// Tipsify: fans around one vertex at a time, emitting all of its remaining
+	// triangles, then moves to the neighbour that is still in the cache and will
+	// stay there longest, or back to a recently used vertex at a dead end.
+	static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = CACHE_SIZE)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) return;
+
+		// Triangles using each vertex, as offsets into one array
+		std::vector<uint32_t> live(vertexCount, 0);
+		for (auto index : indices)
+			++live[index];
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; ++v)
+			offsets[v + 1] = offsets[v] + live[v];
+		std::vector<uint32_t> triangles(indices.size());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+			triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnd, candidates, output;
+		deadEnd.reserve(indices.size());
+		output.reserve(indices.size());
+		uint32_t time = cacheSize + 1;
+		size_t cursor = 0;
+
+		auto fanning = nextLive(live, cursor, deadEnd);
+		while (fanning >= 0)
+		{
+			candidates.clear();
+			for (auto t = offsets[fanning]; t < offsets[fanning + 1]; ++t)
+			{
+				auto triangle = triangles[t];
+				if (emitted[triangle]) continue;
+				emitted[triangle] = true;
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					auto v = indices[triangle * 3 + corner];
+					output.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					--live[v];
+					if (time - cacheTime[v] > (uint32_t)cacheSize)
+						cacheTime[v] = time++;
+				}
+			}
+
+			// Prefer the candidate that entered the cache earliest but will
+			// still be in it after its remaining triangles are emitted
+			int best = -1;
+			uint32_t bestPriority = 0;
+			for (auto v : candidates)
+			{
+				if (live[v] == 0) continue;
+				uint32_t priority = 0;
+				if (time - cacheTime[v] + 2 * live[v] <= (uint32_t)cacheSize)
+					priority = time - cacheTime[v];
+				if (best < 0 || priority > bestPriority)
+				{
+					best = (int)v;
+					bestPriority = priority;
+				}
+			}
+			fanning = best >= 0 ? best : nextLive(live, cursor, deadEnd);
+		}
+		indices.swap(output);
+	}
+
+	// Renumbers vertices in the order indices first reference them, so vertex
+	// fetches walk forward through memory
+	static void optimizeVertexFetch(const unsigned char* vertices, size_t vertexCount, size_t stride,
+		std::vector<uint32_t>& indices, std::vector<unsigned char>& outVertices)
+	{
+		const uint32_t UNUSED = ~0u;
+		std::vector<uint32_t> remap(vertexCount, UNUSED);
+		outVertices.clear();
+		outVertices.reserve(vertexCount * stride);
+		uint32_t next = 0;
+		for (auto& index : indices)
+		{
+			if (remap[index] == UNUSED)
+			{
+				remap[index] = next++;
+				outVertices.insert(outVertices.end(), vertices + index * stride, vertices + (index + 1) * stride);
+			}
+			index = remap[index];
+		}
+	}
+
+	// Average cache miss ratio: vertices transformed per triangle with a FIFO
+	// cache of cacheSize entries. 3 is no reuse at all, 0.5 the ideal for a grid.
+	static float acmr(const uint32_t* indices, size_t count, size_t vertexCount, int cacheSize = CACHE_SIZE)
+	{
+		if (count < 3) return 0.0f;
+		// A vertex is cached if fewer than cacheSize misses happened since its own
+		std::vector<uint32_t> missTime(vertexCount, 0);
+		uint32_t misses = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto v = indices[i];
+			if (missTime[v] == 0 || misses + 1 - missTime[v] > (uint32_t)cacheSize)
+				missTime[v] = ++misses;
+		}
+		return (float)misses / (float)(count / 3);
+	}
+
+	// 16 bit indices when every vertex fits, which is all GLES 2.0 guarantees;
+	// 32 bit ones need GL_OES_element_index_uint
+	static uint32_t indexSize(size_t vertexCount)
+	{
+		return vertexCount <= 0x10000 ? 2 : 4;
+	}
+
+	static std::vector<unsigned char> packIndices(const std::vector<uint32_t>& indices, uint32_t indexSize)
+	{
+		std::vector<unsigned char> packed(indices.size() * indexSize);
+		if (indexSize == 4)
+		{
+			memcpy(packed.data(), indices.data(), packed.size());
+			return packed;
+		}
+		auto out = (uint16_t*)packed.data();
+		for (size_t i = 0; i < indices.size(); ++i)
+			out[i] = (uint16_t)indices[i];
+		return packed;
+	}
+
+private:
+	// FNV-1a
+	static uint32_t hash(const unsigned char* bytes, size_t size)
+	{
+		uint32_t h = 2166136261u;
+		for (size_t i = 0; i < size; ++i)
+			h = (h ^ bytes[i]) * 16777619u;
+		return h;
+	}
+
+	// A dead end: the most recent vertex with triangles left, else the next one in order
+	static int nextLive(const std::vector<uint32_t>& live, size_t& cursor, std::vector<uint32_t>& deadEnd)
+	{
+		while (!deadEnd.empty())
+		{
+			auto v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0) return (int)v;
+		}
+		for (; cursor < live.size(); ++cursor)
+		{
+			if (live[cursor] > 0) return (int)cursor++;
+		}
+		return -1;
+	}
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+// Included by Window.h.
+
+// A window that never appears. surface() is NULL, so Graphic renders
+// headless, and show() runs uncapped whatever fps is asked for.
+class NullWindow : public Window
+{
+public:
+	NullWindow(int width, int height) : Window(width, height) { }
+
+	void* surface() { return NULL; }
+
+	void show(int fps, WindowListener* listener)
+	{
+		Window::show(0, listener);
+	}
+
+protected:
+	bool processEvents() { return true; }
+};
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <cassert>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+#include "Utils.h"
+
+// Per-frame timings of named phases (update, draw, swap, ...) for the last
+// FRAMES frames. CPU time comes from steady_clock; GPU time from
+// GL_EXT_disjoint_timer_query when the driver has it. GPU results arrive a
+// few frames late and are written back into their frame's slot, and frames
+// where the GPU reported a disjoint event (clock change, power state) keep a
+// GPU time of -1. dumpCsv() and dumpChromeTrace() write the ring buffer out;
+// the trace loads in chrome://tracing or ui.perfetto.dev.
+//
+//	const int DRAW = m_profiler.phase("draw");
+//	m_profiler.beginFrame();
+//	{ Profiler::Scope scope(m_profiler, DRAW); glDrawElements(...); }
+//	m_profiler.endFrame();
+class Profiler
+{
+public:
+	static const int MAX_PHASES = 8;
+	static const int FRAMES = 1024;
+
+	class Scope
+	{
+	private:
+		Profiler& m_profiler;
+		int m_phase;
+	public:
+		Scope(Profiler& profiler, int phase) : m_profiler(profiler), m_phase(phase) { m_profiler.begin(phase); }
+		~Scope() { m_profiler.end(m_phase); }
+	};
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// Timer queries are read back this many frames later, by which time the
+	// GPU has normally finished with them.
+	static const int QUERY_LATENCY = 4;
+
+	struct Sample
+	{
+		float cpuStart; // ms since the profiler was created
+		float cpuMs;
+		float gpuMs;    // -1 when not measured
+	};
+
+	const char* m_names[MAX_PHASES];
+	bool m_gpuPhase[MAX_PHASES];
+	int m_numPhases;
+
+	std::vector<Sample> m_samples;
+	int m_frame;
+	Clock::time_point m_epoch;
+	Clock::time_point m_started[MAX_PHASES];
+
+	bool m_gpu;
+	GLuint m_queries[QUERY_LATENCY][MAX_PHASES];
+	bool m_queryIssued[QUERY_LATENCY][MAX_PHASES];
+	PFNGLGENQUERIESEXTPROC glGenQueriesEXT;
+	PFNGLDELETEQUERIESEXTPROC glDeleteQueriesEXT;
+	PFNGLBEGINQUERYEXTPROC glBeginQueryEXT;
+	PFNGLENDQUERYEXTPROC glEndQueryEXT;
+	PFNGLGETQUERYOBJECTUIVEXTPROC glGetQueryObjectuivEXT;
+	PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64vEXT;
+
+public:
+	// Needs a current context if gpuTimers is set.
+	Profiler(bool gpuTimers = true) : m_numPhases(0), m_samples(FRAMES * MAX_PHASES), m_frame(-1),
+		m_epoch(Clock::now()), m_gpu(false)
+	{
+		if (gpuTimers && Utils::hasExtension("GL_EXT_disjoint_timer_query"))
+		{
+			glGenQueriesEXT = (PFNGLGENQUERIESEXTPROC)eglGetProcAddress("glGenQueriesEXT");
+			glDeleteQueriesEXT = (PFNGLDELETEQUERIESEXTPROC)eglGetProcAddress("glDeleteQueriesEXT");
+			glBeginQueryEXT = (PFNGLBEGINQUERYEXTPROC)eglGetProcAddress("glBeginQueryEXT");
+			glEndQueryEXT = (PFNGLENDQUERYEXTPROC)eglGetProcAddress("glEndQueryEXT");
+			glGetQueryObjectuivEXT = (PFNGLGETQUERYOBJECTUIVEXTPROC)eglGetProcAddress("glGetQueryObjectuivEXT");
+			glGetQueryObjectui64vEXT = (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+			m_gpu = glGenQueriesEXT && glDeleteQueriesEXT && glBeginQueryEXT && glEndQueryEXT
+				&& glGetQueryObjectuivEXT && glGetQueryObjectui64vEXT;
+		}
+		if (m_gpu)
+			glGenQueriesEXT(QUERY_LATENCY * MAX_PHASES, &m_queries[0][0]);
+		for (auto i = 0; i < QUERY_LATENCY; ++i)
+			for (auto j = 0; j < MAX_PHASES; ++j)
+				m_queryIssued[i][j] = false;
+	}
+
+	~Profiler()
+	{
+		if (m_gpu)
+			glDeleteQueriesEXT(QUERY_LATENCY * MAX_PHASES, &m_queries[0][0]);
+	}
+
+	bool gpuTimers() const { return m_gpu; }
+
+	// Registers a phase and returns its index. gpu = false for phases a GPU
+	// timer cannot bracket, such as eglSwapBuffers.
+	int phase(const char* name, bool gpu = true)
+	{
+		assert(m_numPhases < MAX_PHASES);
+		m_names[m_numPhases] = name;
+		m_gpuPhase[m_numPhases] = gpu;
+		return m_numPhases++;
+	}
+
+	void beginFrame()
+	{
+		++m_frame;
+		for (auto i = 0; i < MAX_PHASES; ++i)
+			m_samples[slot(m_frame, i)] = { 0.0f, 0.0f, -1.0f };
+		if (m_gpu)
+			collect(m_frame - QUERY_LATENCY);
+	}
+
+	void endFrame() { }
+
+	void begin(int phase)
+	{
+		m_started[phase] = Clock::now();
+		if (m_gpu && m_gpuPhase[phase])
+			glBeginQueryEXT(GL_TIME_ELAPSED_EXT, m_queries[m_frame % QUERY_LATENCY][phase]);
+	}
+
+	void end(int phase)
+	{
+		if (m_gpu && m_gpuPhase[phase])
+		{
+			glEndQueryEXT(GL_TIME_ELAPSED_EXT);
+			m_queryIssued[m_frame % QUERY_LATENCY][phase] = true;
+		}
+		const auto now = Clock::now();
+		auto& sample = m_samples[slot(m_frame, phase)];
+		sample.cpuStart = milliseconds(m_started[phase] - m_epoch);
+		sample.cpuMs = milliseconds(now - m_started[phase]);
+	}
+
+	// One row per frame and phase: frame,phase,cpu_start_ms,cpu_ms,gpu_ms
+	bool dumpCsv(const char* filePath) const
+	{
+		auto file = fopen(filePath, "w");
+		if (!file) return false;
+		fprintf(file, "frame,phase,cpu_start_ms,cpu_ms,gpu_ms\n");
+		for (auto frame = firstFrame(); frame <= m_frame; ++frame)
+			for (auto phase = 0; phase < m_numPhases; ++phase)
+			{
+				const auto& sample = m_samples[slot(frame, phase)];
+				fprintf(file, "%d,%s,%.3f,%.3f,%.3f\n", frame, m_names[phase], sample.cpuStart, sample.cpuMs, sample.gpuMs);
+			}
+		fclose(file);
+		return true;
+	}
+
+	// Trace Event Format. CPU phases go on thread 1; GPU phases on thread 2,
+	// placed at their CPU start since only durations are measured.
+	bool dumpChromeTrace(const char* filePath) const
+	{
+		auto file = fopen(filePath, "w");
+		if (!file) return false;
+		fprintf(file, "{\"traceEvents\":[\n");
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+		for (auto frame = firstFrame(); frame <= m_frame; ++frame)
+			for (auto phase = 0; phase < m_numPhases; ++phase)
+			{
+				const auto& sample = m_samples[slot(frame, phase)];
+				fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"frame\":%d}}",
+					m_names[phase], sample.cpuStart * 1000.0f, sample.cpuMs * 1000.0f, frame);
+				if (sample.gpuMs >= 0.0f)
+					fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"frame\":%d}}",
+						m_names[phase], sample.cpuStart * 1000.0f, sample.gpuMs * 1000.0f, frame);
+			}
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		return true;
+	}
+
+private:
+	int slot(int frame, int phase) const { return (frame % FRAMES) * MAX_PHASES + phase; }
+	int firstFrame() const { return m_frame >= FRAMES ? m_frame - FRAMES + 1 : 0; }
+
+	static float milliseconds(Clock::duration d)
+	{
+		return std::chrono::duration<float, std::milli>(d).count();
+	}
+
+	// Reads back the timer queries issued for frame, dropping them all if the
+	// GPU reported a disjoint event in the meantime.
+	void collect(int frame)
+	{
+		if (frame < 0) return;
+		GLint disjoint = 0;
+		glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+		const auto index = frame % QUERY_LATENCY;
+		for (auto phase = 0; phase < m_numPhases; ++phase)
+		{
+			if (!m_queryIssued[index][phase]) continue;
+			m_queryIssued[index][phase] = false;
+
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuivEXT(m_queries[index][phase], GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+			if (!available || disjoint) continue;
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64vEXT(m_queries[index][phase], GL_QUERY_RESULT_EXT, &nanoseconds);
+			m_samples[slot(frame, phase)].gpuMs = nanoseconds / 1000000.0f;
+		}
+	}
+};
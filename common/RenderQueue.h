@@ -0,0 +1,186 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "GlStateCache.h"
+
+// Records draws as small command packets, each with a 64 bit sort key, and
+// submits them in key order instead of code order:
+//
+//   63..62  layer         drawn in order, e.g. world before UI
+//   61      translucent   opaque draws first, then blended ones
+//   60..13  opaque:       program (12 bits), texture (12), depth (24) front to back
+//           translucent:  depth (24) back to front, program (12), texture (12)
+//
+// Opaque draws are grouped by state, so GlStateCache filters most binds, and
+// still roughly front to back for early depth rejection. Blended draws need
+// back to front order to composite correctly, so depth leads for them. The
+// lowest 13 bits are free; the sort is stable, so equal keys keep the order
+// they were added in. Sorting is an LSD radix sort over 8 bit digits that
+// skips the digits all keys share, or an insertion sort for a few draws;
+// "Benchmarks renderqueue" times it against std::stable_sort.
+//
+//	m_queue.clear();
+//	m_queue.add(RenderQueue::key(0, false, depth, program, texture), command);
+//	m_queue.sort();
+//	m_queue.submit(m_state, [&](const RenderQueue::Command& c) { ...per-draw uniforms... });
+class RenderQueue
+{
+public:
+	static const int DEPTH_BITS = 24;
+	static const int ID_BITS = 12;
+	// Up to this many draws sort by insertion instead of radix
+	static const size_t SMALL_SORT = 48;
+
+	// Everything one glDrawElements needs beyond the vertex attribute setup
+	struct Command
+	{
+		GLuint program;
+		GLuint texture;       // on unit 0
+		GLuint indexBuffer;
+		GLenum mode;
+		GLenum indexType;
+		GLsizei count;
+		uint32_t offset;      // bytes into indexBuffer
+		bool translucent;     // blended, without depth writes
+		int user;             // for the submit callback, e.g. which object
+	};
+
+	// depth is the view distance scaled to [0, 1]; program and texture ids
+	// only group draws, so ids sharing their low bits just batch less well
+	static uint64_t key(int layer, bool translucent, float depth, GLuint program, GLuint texture)
+	{
+		const uint64_t DEPTH_MAX = (1u << DEPTH_BITS) - 1;
+		const uint64_t ID_MASK = (1u << ID_BITS) - 1;
+		depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+		uint64_t quantized = (uint64_t)(depth * DEPTH_MAX);
+		uint64_t state = ((program & ID_MASK) << ID_BITS) | (texture & ID_MASK);
+
+		uint64_t k = (uint64_t)(layer & 3) << 62 | (uint64_t)translucent << 61;
+		if (translucent)
+			k |= (DEPTH_MAX - quantized) << 37 | state << 13;
+		else
+			k |= state << 37 | quantized << 13;
+		return k;
+	}
+
+private:
+	std::vector<Command> m_commands;
+	// [0] holds the keys and command indices, sorted after sort(); [1] is scratch
+	std::vector<uint64_t> m_keys[2];
+	std::vector<uint32_t> m_order[2];
+
+public:
+	void clear()
+	{
+		m_commands.clear();
+		m_keys[0].clear();
+		m_order[0].clear();
+	}
+
+	void add(uint64_t key, const Command& command)
+	{
+		m_keys[0].push_back(key);
+		m_order[0].push_back((uint32_t)m_commands.size());
+		m_commands.push_back(command);
+	}
+
+	void sort()
+	{
+		const size_t count = m_keys[0].size();
+		if (count < 2) return;
+		// Clearing the histograms alone costs more than sorting a few draws
+		if (count <= SMALL_SORT)
+		{
+			insertionSort();
+			return;
+		}
+		m_keys[1].resize(count);
+		m_order[1].resize(count);
+
+		// All eight digit histograms in one pass over the keys
+		size_t histograms[8][256] = {};
+		for (auto k : m_keys[0])
+		{
+			for (int digit = 0; digit < 8; ++digit)
+				++histograms[digit][(k >> (digit * 8)) & 0xff];
+		}
+
+		const auto first = m_keys[0][0];
+		for (int digit = 0; digit < 8; ++digit)
+		{
+			const int shift = digit * 8;
+			auto& histogram = histograms[digit];
+			// Every key has the same digit here, so this pass would not move anything
+			if (histogram[(first >> shift) & 0xff] == count)
+				continue;
+
+			size_t offsets[256];
+			size_t sum = 0;
+			for (int i = 0; i < 256; ++i)
+			{
+				offsets[i] = sum;
+				sum += histogram[i];
+			}
+
+			auto& keys = m_keys[0];
+			auto& order = m_order[0];
+			for (size_t i = 0; i < count; ++i)
+			{
+				auto slot = offsets[(keys[i] >> shift) & 0xff]++;
+				m_keys[1][slot] = keys[i];
+				m_order[1][slot] = order[i];
+			}
+			m_keys[0].swap(m_keys[1]);
+			m_order[0].swap(m_order[1]);
+		}
+	}
+
+	// Issues the draws in sorted order (call sort() first). onDraw(command)
+	// runs after the command's program is in use and before it draws, for
+	// per-draw uniforms. Leaves depth writes on so the next glClear clears depth.
+	template <typename Callback>
+	void submit(GlStateCache& state, Callback onDraw) const
+	{
+		state.activeTexture(GL_TEXTURE0);
+		for (auto index : m_order[0])
+		{
+			auto& command = m_commands[index];
+			state.useProgram(command.program);
+			state.bindTexture(GL_TEXTURE_2D, command.texture);
+			state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, command.indexBuffer);
+			state.enable(GL_BLEND, command.translucent);
+			state.depthMask(!command.translucent);
+			onDraw(command);
+			glDrawElements(command.mode, command.count, command.indexType, (const void*)(uintptr_t)command.offset);
+		}
+		state.depthMask(true);
+	}
+
+	size_t size() const { return m_commands.size(); }
+	// The sorted keys, for inspection
+	const std::vector<uint64_t>& keys() const { return m_keys[0]; }
+
+private:
+	// Stable, in place
+	void insertionSort()
+	{
+		auto& keys = m_keys[0];
+		auto& order = m_order[0];
+		for (size_t i = 1; i < keys.size(); ++i)
+		{
+			auto key = keys[i];
+			auto index = order[i];
+			size_t j = i;
+			for (; j > 0 && keys[j - 1] > key; --j)
+			{
+				keys[j] = keys[j - 1];
+				order[j] = order[j - 1];
+			}
+			keys[j] = key;
+			order[j] = index;
+		}
+	}
+};
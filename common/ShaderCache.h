@@ -0,0 +1,196 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "MappedFile.h"
+#include "Utils.h"
+
+// Links programs once and keeps them on disk through GL_OES_get_program_binary,
+// so later launches skip the compiler. Files are keyed by a hash of both
+// sources, the bound attribute names and the GL vendor, renderer and version
+// strings; a driver update
+// changes the key, and a binary the driver rejects anyway is recompiled and
+// overwritten. Without the extension every load compiles.
+//
+//	ShaderCache cache;
+//	auto program = cache.load(vsSource, fsSource);
+//	printf("%s in %.2f ms\n", cache.lastHit() ? "Cached" : "Compiled", cache.lastMs());
+class ShaderCache
+{
+private:
+	// Precedes the driver's binary in each file
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	static const uint32_t VERSION = 1;
+
+	std::string m_prefix;
+	std::string m_driver;
+	bool m_binaries;
+	PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOES;
+	PFNGLPROGRAMBINARYOESPROC glProgramBinaryOES;
+
+	int m_hits, m_misses;
+	bool m_lastHit;
+	float m_lastMs;
+
+public:
+	// Needs a current context. Files are named prefix<key>.bin, relative to the
+	// working directory unless prefix has a path.
+	ShaderCache(const char* prefix = "shader_") : m_prefix(prefix), m_binaries(false),
+		glGetProgramBinaryOES(NULL), glProgramBinaryOES(NULL), m_hits(0), m_misses(0), m_lastHit(false), m_lastMs(0.0f)
+	{
+		m_driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+
+		GLint formats = 0;
+		if (Utils::hasExtension("GL_OES_get_program_binary"))
+		{
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+			glGetProgramBinaryOES = (PFNGLGETPROGRAMBINARYOESPROC)eglGetProcAddress("glGetProgramBinaryOES");
+			glProgramBinaryOES = (PFNGLPROGRAMBINARYOESPROC)eglGetProcAddress("glProgramBinaryOES");
+		}
+		m_binaries = formats > 0 && glGetProgramBinaryOES && glProgramBinaryOES;
+	}
+
+	// Returns a linked program, or 0 after printing the compile or link log.
+	// attributes[i], if given, is bound to location i before linking.
+	GLuint load(const std::string& vsSource, const std::string& fsSource,
+		const std::vector<std::string>& attributes = std::vector<std::string>())
+	{
+		auto start = std::chrono::steady_clock::now();
+		const auto key = this->key(vsSource, fsSource, attributes);
+
+		auto program = find(key);
+		m_lastHit = program != 0;
+		if (!program)
+		{
+			program = compile(vsSource, fsSource, attributes);
+			if (program) save(key, program);
+		}
+
+		m_lastMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return program;
+	}
+
+	// 64 bit FNV-1a over the driver strings, both sources and the attribute
+	// names, each followed by a 0. Bindings are baked into the binary, so
+	// programs that differ only in them must not share a file.
+	uint64_t key(const std::string& vsSource, const std::string& fsSource,
+		const std::vector<std::string>& attributes = std::vector<std::string>()) const
+	{
+		uint64_t h = 14695981039346656037ull;
+		auto hash = [&h](const std::string& text)
+		{
+			for (size_t i = 0; i <= text.size(); ++i)
+				h = (h ^ (unsigned char)text.c_str()[i]) * 1099511628211ull;
+		};
+		for (auto text : { &m_driver, &vsSource, &fsSource })
+			hash(*text);
+		for (auto& name : attributes)
+			hash(name);
+		return h;
+	}
+
+	// The cached program for key, or 0 when there is none the driver accepts
+	GLuint find(uint64_t key)
+	{
+		auto program = m_binaries ? loadBinary(fileName(key).c_str(), key) : 0;
+		program ? ++m_hits : ++m_misses;
+		return program;
+	}
+
+	// Stores a successfully linked program under key
+	void save(uint64_t key, GLuint program)
+	{
+		if (m_binaries) saveBinary(fileName(key).c_str(), key, program);
+	}
+
+	bool binaries() const { return m_binaries; }
+	int hits() const { return m_hits; }
+	int misses() const { return m_misses; }
+	// Whether the last load() came from disk, and how long it took
+	bool lastHit() const { return m_lastHit; }
+	float lastMs() const { return m_lastMs; }
+
+private:
+	static std::string glString(GLenum name)
+	{
+		auto value = (const char*)glGetString(name);
+		return value ? value : "";
+	}
+
+	std::string fileName(uint64_t key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return m_prefix + name;
+	}
+
+	GLuint loadBinary(const char* path, uint64_t key)
+	{
+		MappedFile file(path);
+		if (!file.okay() || file.size() < sizeof(FileHeader)) return 0;
+		FileHeader header;
+		memcpy(&header, file.data(), sizeof(header));
+		if (memcmp(header.magic, "PBIN", 4) != 0 || header.version != VERSION || header.key != key
+			|| header.length != file.size() - sizeof(FileHeader))
+			return 0;
+
+		auto program = glCreateProgram();
+		glProgramBinaryOES(program, header.format, file.data() + sizeof(FileHeader), header.length);
+		GLint linkedOkay = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linkedOkay);
+		if (linkedOkay) return program;
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	void saveBinary(const char* path, uint64_t key, GLuint program)
+	{
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+		if (length <= 0) return;
+
+		FileHeader header;
+		memcpy(header.magic, "PBIN", 4);
+		header.version = VERSION;
+		header.key = key;
+		std::vector<unsigned char> binary(length);
+		GLenum format = 0;
+		glGetProgramBinaryOES(program, length, &length, &format, binary.data());
+		header.format = format;
+		header.length = (uint32_t)length;
+
+		FILE* file = fopen(path, "wb");
+		if (!file) return;
+		auto okay = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary.data(), 1, length, file) == (size_t)length;
+		// Leave no partial file behind
+		if (fclose(file) != 0 || !okay) remove(path);
+	}
+
+	static GLuint compile(const std::string& vsSource, const std::string& fsSource, const std::vector<std::string>& attributes)
+	{
+		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
+		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
+		GLuint program = 0;
+		if (vs && fs)
+			program = Utils::linkProgram(vs, fs, attributes);
+		// The program keeps what it needs once linked
+		if (vs) glDeleteShader(vs);
+		if (fs) glDeleteShader(fs);
+		return program;
+	}
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <string>
+#include <vector>
+#include <cassert>
+#include "Utils.h"
+#include "ShaderCache.h"
+
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_KHR_parallel_shader_compile 1
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (GL_APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) (GLuint count);
+#endif
+
+// Compiles and links many programs without waiting on each one. submit()
+// only hands the sources to the driver; nothing asks for GL_COMPILE_STATUS
+// or GL_LINK_STATUS, which would block, until the program is collected by
+// poll() or wait(). With GL_KHR_parallel_shader_compile the driver builds on
+// its own threads and poll() only collects programs whose
+// GL_COMPLETION_STATUS_KHR is set; without it, poll() finishes everything
+// submitted, which still batches the stalls after the other startup work.
+//
+//	ShaderCompiler compiler(&cache);
+//	auto ticket = compiler.submit(vsSource, fsSource);
+//	... upload buffers, start texture loads ...
+//	auto program = compiler.wait(ticket);
+class ShaderCompiler
+{
+private:
+	struct Job
+	{
+		GLuint program, vs, fs;
+		uint64_t key;
+		bool done;
+	};
+
+	ShaderCache* m_cache;
+	std::vector<Job> m_jobs;
+	int m_pending;
+	bool m_parallel;
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+
+	ShaderCompiler(const ShaderCompiler&);
+	ShaderCompiler& operator = (const ShaderCompiler&);
+
+public:
+	// Needs a current context. Programs found in cache skip the compiler and
+	// newly linked ones are saved to it.
+	ShaderCompiler(ShaderCache* cache = NULL) : m_cache(cache), m_pending(0), m_parallel(false), glMaxShaderCompilerThreadsKHR(NULL)
+	{
+		if (Utils::hasExtension("GL_KHR_parallel_shader_compile"))
+		{
+			glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+			// Let the driver pick how many threads to use
+			if (glMaxShaderCompilerThreadsKHR)
+				glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+			m_parallel = glMaxShaderCompilerThreadsKHR != NULL;
+		}
+	}
+
+	// Starts building a program and returns the ticket to collect it by.
+	// attributes[i], if given, is bound to location i before linking.
+	int submit(const std::string& vsSource, const std::string& fsSource,
+		const std::vector<std::string>& attributes = std::vector<std::string>())
+	{
+		Job job = { 0, 0, 0, 0, false };
+		if (m_cache)
+		{
+			job.key = m_cache->key(vsSource, fsSource, attributes);
+			job.program = m_cache->find(job.key);
+			job.done = job.program != 0;
+		}
+		if (!job.done)
+		{
+			job.vs = submitShader(vsSource, GL_VERTEX_SHADER);
+			job.fs = submitShader(fsSource, GL_FRAGMENT_SHADER);
+			// Linking does not need the compile results first; a failed
+			// compile shows up as a failed link
+			job.program = glCreateProgram();
+			glAttachShader(job.program, job.vs);
+			glAttachShader(job.program, job.fs);
+			Utils::bindAttributes(job.program, attributes);
+			glLinkProgram(job.program);
+			++m_pending;
+		}
+		m_jobs.push_back(job);
+		return (int)m_jobs.size() - 1;
+	}
+
+	// True once wait(ticket) would not block
+	bool ready(int ticket) const
+	{
+		auto& job = m_jobs[ticket];
+		if (job.done || !m_parallel) return true;
+		GLint completed = GL_FALSE;
+		glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &completed);
+		return completed != GL_FALSE;
+	}
+
+	// Hands programs that have finished building to onBuilt(ticket, program),
+	// program being 0 if it failed, each only once. Call on the GL thread.
+	template <typename Callback>
+	int poll(Callback onBuilt)
+	{
+		int count = 0;
+		for (int ticket = 0; ticket < (int)m_jobs.size() && m_pending > 0; ++ticket)
+		{
+			if (m_jobs[ticket].done || !ready(ticket)) continue;
+			onBuilt(ticket, finish(m_jobs[ticket]));
+			++count;
+		}
+		return count;
+	}
+
+	// The program for ticket, blocking until it is built; 0 if it failed
+	GLuint wait(int ticket)
+	{
+		auto& job = m_jobs[ticket];
+		return job.done ? job.program : finish(job);
+	}
+
+	int pending() const { return m_pending; }
+	bool parallel() const { return m_parallel; }
+
+private:
+	static GLuint submitShader(const std::string& source, GLenum type)
+	{
+		auto shader = glCreateShader(type);
+		auto src = source.c_str();
+		glShaderSource(shader, 1, &src, NULL);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	GLuint finish(Job& job)
+	{
+		assert(!job.done);
+		if (!Utils::checkProgram(job.program))
+		{
+			// The compile logs say more than the link log does
+			Utils::checkShader(job.vs, GL_VERTEX_SHADER);
+			Utils::checkShader(job.fs, GL_FRAGMENT_SHADER);
+			glDeleteProgram(job.program);
+			job.program = 0;
+		}
+		else if (m_cache)
+		{
+			m_cache->save(job.key, job.program);
+		}
+		glDeleteShader(job.vs);
+		glDeleteShader(job.fs);
+		job.vs = job.fs = 0;
+		job.done = true;
+		--m_pending;
+		return job.program;
+	}
+};
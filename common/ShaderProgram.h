@@ -0,0 +1,246 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <cassert>
+
+// Owns a linked program and reflects its active uniforms and attributes once,
+// into tables keyed by a hash of each name. Look names up at startup with the
+// constexpr hash() and keep the returned index; per-frame uploads then index
+// straight into the table, and a uniform given the value it already holds is
+// not uploaded again. set() needs the program to be in use.
+//
+//	const int MATRIX = m_program.uniform(ShaderProgram::hash("u_matrix"));
+//	m_program.set(MATRIX, matrix.data());
+class ShaderProgram
+{
+public:
+	// FNV-1a, usable in constant expressions
+	static constexpr uint32_t hash(const char* name, uint32_t h = 2166136261u)
+	{
+		return *name ? hash(name + 1, (h ^ (unsigned char)*name) * 16777619u) : h;
+	}
+
+private:
+	// The most floats a uniform can hold and still be cached: a mat4
+	static const int MAX_CACHED = 16;
+
+	struct Uniform
+	{
+		uint32_t hash;
+		GLint location;
+		GLenum type;
+		GLint size;
+		bool set;
+		// Raw bits, compared with memcmp; ints are stored as they are, not converted
+		float value[MAX_CACHED];
+	};
+
+	struct Attribute
+	{
+		uint32_t hash;
+		GLint location;
+		GLenum type;
+	};
+
+	GLuint m_program;
+	std::vector<Uniform> m_uniforms;
+	std::vector<Attribute> m_attributes;
+	// Open addressing over the hashes; entries are indices, -1 when empty
+	std::vector<int> m_uniformTable, m_attributeTable;
+	int m_uploads, m_skipped;
+
+	ShaderProgram(const ShaderProgram&);
+	ShaderProgram& operator = (const ShaderProgram&);
+
+public:
+	ShaderProgram() : m_program(0), m_uploads(0), m_skipped(0)
+	{
+	}
+
+	~ShaderProgram()
+	{
+		if (m_program) glDeleteProgram(m_program);
+	}
+
+	// Takes ownership of a linked program
+	void reset(GLuint program)
+	{
+		if (m_program) glDeleteProgram(m_program);
+		m_program = program;
+		m_uniforms.clear();
+		m_attributes.clear();
+		m_uniformTable.clear();
+		m_attributeTable.clear();
+		if (!program) return;
+
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> name(maxLength + 1);
+		for (GLint i = 0; i < count; ++i)
+		{
+			Uniform uniform;
+			glGetActiveUniform(program, i, (GLsizei)name.size(), NULL, &uniform.size, &uniform.type, name.data());
+			uniform.location = glGetUniformLocation(program, name.data());
+			uniform.hash = hash(baseName(name.data()).c_str());
+			uniform.set = false;
+			m_uniforms.push_back(uniform);
+		}
+
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+		name.resize(maxLength + 1);
+		for (GLint i = 0; i < count; ++i)
+		{
+			Attribute attribute;
+			GLint size;
+			glGetActiveAttrib(program, i, (GLsizei)name.size(), NULL, &size, &attribute.type, name.data());
+			attribute.location = glGetAttribLocation(program, name.data());
+			attribute.hash = hash(name.data());
+			m_attributes.push_back(attribute);
+		}
+
+		buildTable(m_uniforms, m_uniformTable);
+		buildTable(m_attributes, m_attributeTable);
+	}
+
+	void use() const { glUseProgram(m_program); }
+	GLuint id() const { return m_program; }
+	int uniformCount() const { return (int)m_uniforms.size(); }
+	int attributeCount() const { return (int)m_attributes.size(); }
+
+	// Index of an active uniform for set(), or -1; arrays go by their name without [0]
+	int uniform(uint32_t nameHash) const
+	{
+		return find(m_uniforms, m_uniformTable, nameHash);
+	}
+
+	// Location of an active attribute, or -1
+	GLint attribute(uint32_t nameHash) const
+	{
+		auto index = find(m_attributes, m_attributeTable, nameHash);
+		return index >= 0 ? m_attributes[index].location : -1;
+	}
+
+	// Samplers, ints and bools; -1 is ignored like a -1 location
+	void set(int uniform, GLint value)
+	{
+		if (uniform < 0) return;
+		auto& u = m_uniforms[uniform];
+		static_assert(sizeof(GLint) == sizeof(float), "ints are cached in a float slot");
+		float cached;
+		memcpy(&cached, &value, sizeof(cached));
+		if (unchanged(u, &cached, 1)) return;
+		glUniform1i(u.location, value);
+	}
+
+	void set(int uniform, float value)
+	{
+		setFloats(uniform, &value);
+	}
+
+	// As many floats as the uniform's type holds, e.g. 16 for a mat4; arrays
+	// take their first element
+	void set(int uniform, const float* values)
+	{
+		setFloats(uniform, values);
+	}
+
+	// Calls that reached GL and calls skipped because the value had not changed
+	int uploads() const { return m_uploads; }
+	int skipped() const { return m_skipped; }
+
+private:
+	// glGetActiveUniform reports arrays as name[0]
+	static std::string baseName(const char* name)
+	{
+		std::string base(name);
+		auto bracket = base.find('[');
+		if (bracket != std::string::npos) base.resize(bracket);
+		return base;
+	}
+
+	template <typename Entry>
+	static void buildTable(const std::vector<Entry>& entries, std::vector<int>& table)
+	{
+		size_t size = 4;
+		while (size < entries.size() * 2) size *= 2;
+		table.assign(size, -1);
+		for (int i = 0; i < (int)entries.size(); ++i)
+		{
+			auto slot = entries[i].hash & (size - 1);
+			while (table[slot] >= 0)
+			{
+				// Two names with one hash would shadow each other
+				assert(entries[table[slot]].hash != entries[i].hash);
+				slot = (slot + 1) & (size - 1);
+			}
+			table[slot] = i;
+		}
+	}
+
+	template <typename Entry>
+	static int find(const std::vector<Entry>& entries, const std::vector<int>& table, uint32_t nameHash)
+	{
+		if (table.empty()) return -1;
+		for (auto slot = nameHash & (table.size() - 1); table[slot] >= 0; slot = (slot + 1) & (table.size() - 1))
+		{
+			if (entries[table[slot]].hash == nameHash) return table[slot];
+		}
+		return -1;
+	}
+
+	static int components(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_FLOAT_VEC2: return 2;
+		case GL_FLOAT_VEC3: return 3;
+		case GL_FLOAT_VEC4: return 4;
+		case GL_FLOAT_MAT2: return 4;
+		case GL_FLOAT_MAT3: return 9;
+		case GL_FLOAT_MAT4: return 16;
+		default: return 1;
+		}
+	}
+
+	// Records value and returns true if it is what the uniform already holds.
+	// Arrays are always uploaded.
+	bool unchanged(Uniform& u, const float* value, int count)
+	{
+		if (u.size == 1)
+		{
+			if (u.set && memcmp(u.value, value, count * sizeof(float)) == 0)
+			{
+				++m_skipped;
+				return true;
+			}
+			memcpy(u.value, value, count * sizeof(float));
+			u.set = true;
+		}
+		++m_uploads;
+		return false;
+	}
+
+	void setFloats(int uniform, const float* values)
+	{
+		if (uniform < 0) return;
+		auto& u = m_uniforms[uniform];
+		if (unchanged(u, values, components(u.type))) return;
+		switch (u.type)
+		{
+		case GL_FLOAT: glUniform1fv(u.location, 1, values); break;
+		case GL_FLOAT_VEC2: glUniform2fv(u.location, 1, values); break;
+		case GL_FLOAT_VEC3: glUniform3fv(u.location, 1, values); break;
+		case GL_FLOAT_VEC4: glUniform4fv(u.location, 1, values); break;
+		case GL_FLOAT_MAT2: glUniformMatrix2fv(u.location, 1, GL_FALSE, values); break;
+		case GL_FLOAT_MAT3: glUniformMatrix3fv(u.location, 1, GL_FALSE, values); break;
+		case GL_FLOAT_MAT4: glUniformMatrix4fv(u.location, 1, GL_FALSE, values); break;
+		default: assert(!"not a float uniform"); break;
+		}
+	}
+};
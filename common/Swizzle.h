@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stddef.h>
+
+// On x86 the SSSE3 and AVX2 kernels are always compiled and picked at run
+// time from CPUID, since MSVC builds neither announce nor need /arch for
+// them. GCC and Clang compile each kernel for its own target instead.
+// NEON is part of every ARMv8 core, so there it is chosen at compile time.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SWIZZLE_TARGET(isa)
+#else
+#define SWIZZLE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#define SWIZZLE_X86
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SWIZZLE_NEON
+#endif
+
+// Swaps the first and third byte of every pixel: BGR(A) <-> RGB(A).
+// src and dst may be the same buffer, but must not otherwise overlap.
+class Swizzle
+{
+public:
+	enum Level { Scalar, Ssse3, Avx2 };
+
+	static void swap24(const unsigned char* src, unsigned char* dst, size_t count)
+	{
+		size_t i = 0;
+		const size_t bytes = count * 3;
+#if defined(SWIZZLE_X86)
+		if (level() == Avx2) i = swap24Avx2(src, dst, bytes);
+		else if (level() == Ssse3) i = swap24Ssse3(src, dst, bytes, 0);
+#elif defined(SWIZZLE_NEON)
+		for (; i + 48 <= bytes; i += 48)
+		{
+			auto v = vld3q_u8(src + i);
+			auto b = v.val[0];
+			v.val[0] = v.val[2];
+			v.val[2] = b;
+			vst3q_u8(dst + i, v);
+		}
+#endif
+		for (; i < bytes; i += 3)
+		{
+			auto b = src[i];
+			dst[i] = src[i + 2];
+			dst[i + 1] = src[i + 1];
+			dst[i + 2] = b;
+		}
+	}
+
+	static void swap32(const unsigned char* src, unsigned char* dst, size_t count)
+	{
+		size_t i = 0;
+		const size_t bytes = count * 4;
+#if defined(SWIZZLE_X86)
+		if (level() == Avx2) i = swap32Avx2(src, dst, bytes);
+		else if (level() == Ssse3) i = swap32Ssse3(src, dst, bytes, 0);
+#elif defined(SWIZZLE_NEON)
+		for (; i + 64 <= bytes; i += 64)
+		{
+			auto v = vld4q_u8(src + i);
+			auto b = v.val[0];
+			v.val[0] = v.val[2];
+			v.val[2] = b;
+			vst4q_u8(dst + i, v);
+		}
+#endif
+		for (; i < bytes; i += 4)
+		{
+			auto b = src[i];
+			dst[i] = src[i + 2];
+			dst[i + 1] = src[i + 1];
+			dst[i + 2] = b;
+			dst[i + 3] = src[i + 3];
+		}
+	}
+
+	static void swap(const unsigned char* src, unsigned char* dst, size_t count, int channels)
+	{
+		if (channels == 4) swap32(src, dst, count);
+		else swap24(src, dst, count);
+	}
+
+	// The x86 kernels swap24 and swap32 use on this CPU; Scalar elsewhere,
+	// where NEON, if any, is fixed at compile time
+	static Level level()
+	{
+#if defined(SWIZZLE_X86)
+		static const Level detected = detect();
+		return detected;
+#else
+		return Scalar;
+#endif
+	}
+
+#if defined(SWIZZLE_X86)
+private:
+	static Level detect()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		const auto maxLeaf = info[0];
+		__cpuid(info, 1);
+		const auto ssse3 = (info[2] & (1 << 9)) != 0;
+		// AVX2 also needs the OS to save the YMM registers (OSXSAVE, XCR0 bits 1-2)
+		auto avx2 = false;
+		if (maxLeaf >= 7 && (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		__builtin_cpu_init();
+		const bool ssse3 = __builtin_cpu_supports("ssse3");
+		const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+		return avx2 ? Avx2 : (ssse3 ? Ssse3 : Scalar);
+	}
+
+	// Each kernel returns how many bytes it did; the scalar loop finishes the rest
+
+	// Five pixels per 16 byte register; byte 15 belongs to the next pixel and
+	// passes through unchanged until the next step overwrites it.
+	SWIZZLE_TARGET("ssse3")
+	static size_t swap24Ssse3(const unsigned char* src, unsigned char* dst, size_t bytes, size_t i)
+	{
+		const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+		for (; i + 16 <= bytes; i += 15)
+		{
+			auto v = _mm_loadu_si128((const __m128i*)(src + i));
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(v, mask));
+		}
+		return i;
+	}
+
+	// Ten pixels per step, as two overlapping 15 byte halves of one register
+	SWIZZLE_TARGET("avx2")
+	static size_t swap24Avx2(const unsigned char* src, unsigned char* dst, size_t bytes)
+	{
+		const __m256i mask = _mm256_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15,
+			2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+		size_t i = 0;
+		for (; i + 31 <= bytes; i += 30)
+		{
+			auto lo = _mm_loadu_si128((const __m128i*)(src + i));
+			auto hi = _mm_loadu_si128((const __m128i*)(src + i + 15));
+			auto v = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), mask);
+			_mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(v));
+			_mm_storeu_si128((__m128i*)(dst + i + 15), _mm256_extracti128_si256(v, 1));
+		}
+		return swap24Ssse3(src, dst, bytes, i);
+	}
+
+	SWIZZLE_TARGET("ssse3")
+	static size_t swap32Ssse3(const unsigned char* src, unsigned char* dst, size_t bytes, size_t i)
+	{
+		const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		for (; i + 16 <= bytes; i += 16)
+		{
+			auto v = _mm_loadu_si128((const __m128i*)(src + i));
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_shuffle_epi8(v, mask));
+		}
+		return i;
+	}
+
+	SWIZZLE_TARGET("avx2")
+	static size_t swap32Avx2(const unsigned char* src, unsigned char* dst, size_t bytes)
+	{
+		// The shuffle indexes within each 128 bit lane
+		const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		size_t i = 0;
+		for (; i + 32 <= bytes; i += 32)
+		{
+			auto v = _mm256_loadu_si256((const __m256i*)(src + i));
+			_mm256_storeu_si256((__m256i*)(dst + i), _mm256_shuffle_epi8(v, mask));
+		}
+		return swap32Ssse3(src, dst, bytes, i);
+	}
+#endif
+};
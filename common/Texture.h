@@ -0,0 +1,173 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <stdint.h>
+#include "Utils.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TEXTURE_NEON
+#endif
+
+// Uploads 8 bit RGB/RGBA images, optionally with a full mip chain sampled
+// trilinearly (GL_LINEAR_MIPMAP_LINEAR). Minified surfaces then read from a
+// level close to their screen size instead of skipping across the full
+// size image, which is far kinder to the texture cache.
+class Texture
+{
+public:
+	enum Filter
+	{
+		Linear,       // level 0 only, GL_LINEAR
+		Mipmap,       // glGenerateMipmap on the GPU
+		MipmapBox     // 2x2 box filtered on the CPU, e.g. for baking offline
+	};
+
+	// Leaves texture bound. GLES 2.0 can only mipmap power of two sizes
+	// unless GL_OES_texture_npot is there; other sizes fall back to Linear.
+	static void upload(GLuint texture, int width, int height, bool hasAlpha, const unsigned char* data, Filter filter = Linear)
+	{
+		if (filter != Linear && !canMipmap(width, height))
+			filter = Linear;
+
+		// Rows are tightly packed, which for RGB the default alignment of 4 only
+		// matches when the width is a multiple of 4
+		GLint alignment;
+		glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		auto format = hasAlpha ? GL_RGBA : GL_RGB;
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter == Linear ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+
+		if (filter == Mipmap)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		else if (filter == MipmapBox)
+		{
+			const int channels = hasAlpha ? 4 : 3;
+			std::vector<unsigned char> levels[2];
+			auto source = data;
+			for (int level = 1; width > 1 || height > 1; ++level)
+			{
+				auto& target = levels[level & 1];
+				target.resize((size_t)levelSize(width) * levelSize(height) * channels);
+				downsample(source, width, height, channels, target.data());
+				width = levelSize(width);
+				height = levelSize(height);
+				glTexImage2D(GL_TEXTURE_2D, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, target.data());
+				source = target.data();
+			}
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	}
+
+	static bool canMipmap(int width, int height)
+	{
+		return (isPowerOfTwo(width) && isPowerOfTwo(height)) || Utils::hasExtension("GL_OES_texture_npot");
+	}
+
+	static bool isPowerOfTwo(int n)
+	{
+		return n > 0 && (n & (n - 1)) == 0;
+	}
+
+	// Size of the next mip level down
+	static int levelSize(int n)
+	{
+		return (std::max)(n / 2, 1);
+	}
+
+	// Halves a width x height image with a 2x2 box filter, rounding to nearest.
+	// Sizes round down, so an odd last row or column is dropped; a side that is
+	// already 1 pixel stays 1 and is averaged with itself. Big images are split
+	// into bands of rows across threads.
+	static void downsample(const unsigned char* src, int width, int height, int channels, unsigned char* dst)
+	{
+		const int outHeight = levelSize(height);
+		const int MIN_ROWS_PER_THREAD = 64;
+		int threads = (std::min)((int)std::thread::hardware_concurrency(), outHeight / MIN_ROWS_PER_THREAD);
+		if (threads <= 1)
+		{
+			downsampleRows(src, width, height, channels, dst, 0, outHeight);
+			return;
+		}
+
+		std::vector<std::thread> workers;
+		for (int i = 0; i < threads; ++i)
+		{
+			int first = outHeight * i / threads;
+			int last = outHeight * (i + 1) / threads;
+			workers.emplace_back([=] { downsampleRows(src, width, height, channels, dst, first, last); });
+		}
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+private:
+	static void downsampleRows(const unsigned char* src, int width, int height, int channels, unsigned char* dst, int firstRow, int lastRow)
+	{
+		const int outWidth = levelSize(width);
+		const size_t rowBytes = (size_t)width * channels;
+		std::vector<uint16_t> sums(rowBytes);
+
+		for (int y = firstRow; y < lastRow; ++y)
+		{
+			auto row0 = src + (size_t)(2 * y) * rowBytes;
+			auto row1 = src + (size_t)(std::min)(2 * y + 1, height - 1) * rowBytes;
+			addRows(row0, row1, sums.data(), rowBytes);
+
+			auto out = dst + (size_t)y * outWidth * channels;
+			if (channels == 4) addColumns<4>(sums.data(), width, out);
+			else addColumns<3>(sums.data(), width, out);
+		}
+	}
+
+	// sums[i] = row0[i] + row1[i], sixteen bytes at a time
+	static void addRows(const unsigned char* row0, const unsigned char* row1, uint16_t* sums, size_t count)
+	{
+		size_t i = 0;
+#if defined(TEXTURE_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= count; i += 16)
+		{
+			auto a = _mm_loadu_si128((const __m128i*)(row0 + i));
+			auto b = _mm_loadu_si128((const __m128i*)(row1 + i));
+			_mm_storeu_si128((__m128i*)(sums + i), _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+			_mm_storeu_si128((__m128i*)(sums + i + 8), _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
+		}
+#elif defined(TEXTURE_NEON)
+		for (; i + 16 <= count; i += 16)
+		{
+			auto a = vld1q_u8(row0 + i);
+			auto b = vld1q_u8(row1 + i);
+			vst1q_u16(sums + i, vaddl_u8(vget_low_u8(a), vget_low_u8(b)));
+			vst1q_u16(sums + i + 8, vaddl_u8(vget_high_u8(a), vget_high_u8(b)));
+		}
+#endif
+		for (; i < count; ++i)
+			sums[i] = (uint16_t)(row0[i] + row1[i]);
+	}
+
+	template <int Channels>
+	static void addColumns(const uint16_t* sums, int width, unsigned char* out)
+	{
+		const int outWidth = levelSize(width);
+		for (int x = 0; x < outWidth; ++x, out += Channels)
+		{
+			auto a = sums + (2 * x) * Channels;
+			auto b = sums + (std::min)(2 * x + 1, width - 1) * Channels;
+			for (int c = 0; c < Channels; ++c)
+				out[c] = (unsigned char)((a[c] + b[c] + 2) >> 2);
+		}
+	}
+};
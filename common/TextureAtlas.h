@@ -0,0 +1,224 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cassert>
+#include <string.h>
+#include "Tga.h"
+#include "Swizzle.h"
+#include "Texture.h"
+
+// Packs many Tga images into one texture so objects using different images
+// can share a texture binding and be drawn in a single call.
+// Each sprite is surrounded by a gutter of its own edge pixels, so linear
+// filtering at a sprite's border never picks up its neighbours.
+// The atlas is a power of two on both sides, which GLES 2.0 needs for
+// mipmaps and repeat wrapping.
+// add() and pack() make no GL calls, so they can run on a worker thread
+// (AssetLoader::loadAtlas); upload() needs the GL thread.
+class TextureAtlas
+{
+public:
+	// Texture coordinates of a sprite inside the atlas, v0 being the sprite's first row.
+	struct Rect
+	{
+		float u0, v0, u1, v1;
+
+		float u(float s) const { return u0 + (u1 - u0) * s; }
+		float v(float t) const { return v0 + (v1 - v0) * t; }
+	};
+
+private:
+	struct Sprite
+	{
+		int width, height;
+		int x, y;
+		bool hasAlpha;
+		// RGB(A) pixels copied from a Tga, or a mapped file still in BGR(A) order
+		std::vector<unsigned char> pixels;
+		std::unique_ptr<TgaView> view;
+		Rect rect;
+	};
+
+	int m_gutter;
+	int m_width, m_height;
+	bool m_hasAlpha;
+	std::vector<Sprite> m_sprites;
+	std::vector<unsigned char> m_pixels;
+
+public:
+	TextureAtlas(int gutter = 4) : m_gutter(gutter), m_width(0), m_height(0), m_hasAlpha(false) { }
+
+	// Copies the image, returns its sprite index.
+	int add(const Tga& tga)
+	{
+		assert(tga.okay());
+		Sprite sprite;
+		sprite.width = tga.width();
+		sprite.height = tga.height();
+		sprite.x = sprite.y = 0;
+		sprite.rect = Rect();
+		sprite.hasAlpha = tga.hasAlpha();
+		auto size = sprite.width * sprite.height * (sprite.hasAlpha ? 4 : 3);
+		sprite.pixels.assign(tga.data(), tga.data() + size);
+		m_hasAlpha = m_hasAlpha || sprite.hasAlpha;
+		m_sprites.push_back(std::move(sprite));
+		return (int)m_sprites.size() - 1;
+	}
+
+	// Maps the file; its pixels are read once, straight from the mapping, by pack().
+	// Compressed and color-mapped files are decoded up front instead.
+	int add(const char* file)
+	{
+		std::unique_ptr<TgaView> view(new TgaView(file));
+		if (!view->okay())
+			return add(Tga(file));
+		Sprite sprite;
+		sprite.width = view->width();
+		sprite.height = view->height();
+		sprite.x = sprite.y = 0;
+		sprite.rect = Rect();
+		sprite.hasAlpha = view->hasAlpha();
+		sprite.view = std::move(view);
+		m_hasAlpha = m_hasAlpha || sprite.hasAlpha;
+		m_sprites.push_back(std::move(sprite));
+		return (int)m_sprites.size() - 1;
+	}
+
+	// Places all sprites with a shelf packer, trying power of two sizes from the
+	// smallest that could hold them up to maxSize x maxSize.
+	// Returns false if they don't fit.
+	bool pack(int maxSize)
+	{
+		assert(!m_sprites.empty());
+
+		// Tallest first keeps shelves tight
+		std::vector<int> order(m_sprites.size());
+		long long area = 0;
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = (int)i;
+			area += (long long)(m_sprites[i].width + 2 * m_gutter) * (m_sprites[i].height + 2 * m_gutter);
+		}
+		std::sort(order.begin(), order.end(), [this](int a, int b) { return m_sprites[a].height > m_sprites[b].height; });
+
+		int width = 1, height = 1;
+		while ((long long)width * height < area)
+		{
+			if (width <= height) width *= 2;
+			else height *= 2;
+		}
+
+		while (width <= maxSize && height <= maxSize)
+		{
+			if (place(order, width, height))
+			{
+				m_width = width;
+				m_height = height;
+				compose();
+				return true;
+			}
+			if (width <= height) width *= 2;
+			else height *= 2;
+		}
+		return false;
+	}
+
+	// Uploads the packed atlas into texture and frees the CPU copy of the pixels.
+	// A gutter of g pixels keeps sprites apart for about log2(g) mip levels;
+	// smaller levels blend neighbouring sprites together.
+	void upload(GLuint texture, Texture::Filter filter = Texture::Linear)
+	{
+		assert(!m_pixels.empty());
+		Texture::upload(texture, m_width, m_height, m_hasAlpha, m_pixels.data(), filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		std::vector<unsigned char>().swap(m_pixels);
+	}
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	bool hasAlpha() const { return m_hasAlpha; }
+	int count() const { return (int)m_sprites.size(); }
+	const Rect& rect(int sprite) const { return m_sprites[sprite].rect; }
+	const unsigned char* data() const { return m_pixels.data(); }
+
+private:
+	bool place(const std::vector<int>& order, int width, int height)
+	{
+		int x = 0, y = 0, shelfHeight = 0;
+		for (auto i : order)
+		{
+			auto& sprite = m_sprites[i];
+			auto w = sprite.width + 2 * m_gutter;
+			auto h = sprite.height + 2 * m_gutter;
+			if (w > width) return false;
+			if (x + w > width)
+			{
+				x = 0;
+				y += shelfHeight;
+				shelfHeight = 0;
+			}
+			if (y + h > height) return false;
+			sprite.x = x + m_gutter;
+			sprite.y = y + m_gutter;
+			x += w;
+			shelfHeight = (std::max)(shelfHeight, h);
+		}
+		return true;
+	}
+
+	void compose()
+	{
+		const int channels = m_hasAlpha ? 4 : 3;
+		m_pixels.assign((size_t)m_width * m_height * channels, 0);
+
+		for (auto& sprite : m_sprites)
+		{
+			const int srcChannels = sprite.hasAlpha ? 4 : 3;
+			const unsigned char* pixels = sprite.view ? sprite.view->bgrData() : sprite.pixels.data();
+			const int red = sprite.view ? 2 : 0;
+			for (int row = -m_gutter; row < sprite.height + m_gutter; ++row)
+			{
+				auto srcRow = (std::min)((std::max)(row, 0), sprite.height - 1);
+				auto src = pixels + (size_t)srcRow * sprite.width * srcChannels;
+				auto dst = m_pixels.data() + ((size_t)(sprite.y + row) * m_width + sprite.x) * channels;
+
+				// Same layout: the row is one bulk copy (or SIMD swizzle), leaving the gutters
+				const bool bulk = srcChannels == channels;
+				if (bulk)
+				{
+					if (red) Swizzle::swap(src, dst, sprite.width, channels);
+					else memcpy(dst, src, (size_t)sprite.width * channels);
+				}
+
+				for (int column = -m_gutter; column < sprite.width + m_gutter; ++column)
+				{
+					if (bulk && column == 0)
+					{
+						column = sprite.width - 1;
+						continue;
+					}
+					auto srcColumn = (std::min)((std::max)(column, 0), sprite.width - 1);
+					auto pixel = src + srcColumn * srcChannels;
+					auto out = dst + column * channels;
+					out[0] = pixel[red];
+					out[1] = pixel[1];
+					out[2] = pixel[2 - red];
+					if (channels == 4) out[3] = srcChannels == 4 ? pixel[3] : 255;
+				}
+			}
+
+			sprite.rect.u0 = (float)sprite.x / m_width;
+			sprite.rect.v0 = (float)sprite.y / m_height;
+			sprite.rect.u1 = (float)(sprite.x + sprite.width) / m_width;
+			sprite.rect.v1 = (float)(sprite.y + sprite.height) / m_height;
+
+			// Only needed until the atlas is composed
+			std::vector<unsigned char>().swap(sprite.pixels);
+			sprite.view.reset();
+		}
+	}
+};
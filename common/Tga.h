@@ -1,7 +1,16 @@
 #pragma once
 
 #include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "MappedFile.h"
+#include "Swizzle.h"
 
+// Loads true-color (types 2, 10), grayscale (3, 11) and color-mapped (1, 9)
+// images, raw or run-length encoded, into RGB or RGBA. Grayscale expands to
+// RGB so callers only ever see 3 or 4 channels. "Benchmarks tga" reports
+// the size and decode time of each type.
 class Tga
 {
 public:
@@ -11,33 +20,144 @@ public:
 		CouldNotOpenFile,
 		NotSupportIndexedColor,
 		NotSupportCompressedFormat,
-		InvalidBitsPerPixel
+		InvalidBitsPerPixel,
+		TruncatedFile
+	};
+
+	enum ImageType
+	{
+		ImageColorMapped = 1,
+		ImageTrueColor = 2,
+		ImageGrayscale = 3,
+		ImageRunLength = 8
+	};
+
+	// The 18 byte file header, read field by field since it is not aligned.
+	struct Header
+	{
+		static const size_t SIZE = 18;
+
+		unsigned char idLength;
+		unsigned char colorMapType;
+		unsigned char type;
+		unsigned short colorMapFirst, colorMapLength;
+		unsigned char colorMapBits;
+		unsigned short width, height;
+		unsigned char bitsPerPixel;
+		unsigned char descriptor;
+
+		bool parse(const unsigned char* p, size_t size)
+		{
+			if (size < SIZE) return false;
+			idLength = p[0];
+			colorMapType = p[1];
+			type = p[2];
+			colorMapFirst = readShort(p + 3);
+			colorMapLength = readShort(p + 5);
+			colorMapBits = p[7];
+			width = readShort(p + 12);
+			height = readShort(p + 14);
+			bitsPerPixel = p[16];
+			descriptor = p[17];
+			return true;
+		}
+
+		int baseType() const { return type & ~ImageRunLength; }
+		bool compressed() const { return (type & ImageRunLength) != 0; }
+
+		// Channels of the decoded image
+		int channels() const
+		{
+			if (baseType() == ImageColorMapped) return colorMapBits == 32 ? 4 : 3;
+			if (baseType() == ImageGrayscale) return bitsPerPixel == 16 ? 4 : 3;
+			return bitsPerPixel == 32 ? 4 : 3;
+		}
+
+		size_t colorMapOffset() const { return SIZE + idLength; }
+
+		// The image id and the color map come between the header and the pixels
+		size_t pixelOffset() const
+		{
+			return colorMapOffset() + (colorMapType ? colorMapLength * ((colorMapBits + 7) / 8) : 0);
+		}
+
+		// Size of the pixels on disk when they are not compressed
+		size_t pixelSize() const
+		{
+			return (size_t)width * height * (bitsPerPixel / 8);
+		}
+
+		Status validate(size_t fileSize) const
+		{
+			switch (baseType())
+			{
+			case ImageColorMapped:
+				if (!colorMapType || (colorMapBits != 24 && colorMapBits != 32)) return NotSupportIndexedColor;
+				if (bitsPerPixel != 8 && bitsPerPixel != 16) return InvalidBitsPerPixel;
+				break;
+			case ImageTrueColor:
+				if (bitsPerPixel != 24 && bitsPerPixel != 32) return InvalidBitsPerPixel;
+				break;
+			case ImageGrayscale:
+				if (bitsPerPixel != 8 && bitsPerPixel != 16) return InvalidBitsPerPixel;
+				break;
+			default:
+				return NotSupportCompressedFormat;
+			}
+			// Compressed data is bounds checked while decoding
+			if (pixelOffset() + (compressed() ? 0 : pixelSize()) > fileSize) return TruncatedFile;
+			return Okay;
+		}
+
+	private:
+		static unsigned short readShort(const unsigned char* p)
+		{
+			return (unsigned short)(p[0] | (p[1] << 8));
+		}
 	};
 
 private:
 	unsigned short m_width, m_height;
-	unsigned char m_bitsPerPixel, m_type;
+	unsigned char m_channels, m_type;
 	unsigned char* m_data;
 	Status m_status;
 
+	// How a file pixel becomes an output pixel
+	int m_sourceType;
+	int m_sourceBytes;
+	std::vector<unsigned char> m_palette;
+
+	Tga(const Tga&);
+	Tga& operator = (const Tga&);
+
 public:
-	Tga(const char* filePath) : m_data(NULL)
+	Tga(const char* filePath) : m_width(0), m_height(0), m_channels(0), m_type(0), m_data(NULL)
 	{
-		FILE* file = fopen(filePath, "rb");
-		if (!file) { m_status = CouldNotOpenFile; return; }
+		MappedFile file(filePath);
+		if (!file.okay()) { m_status = CouldNotOpenFile; return; }
 
-		loadHeader(file);
+		Header header;
+		if (!header.parse(file.data(), file.size())) { m_status = TruncatedFile; return; }
+		m_width = header.width;
+		m_height = header.height;
+		m_channels = (unsigned char)header.channels();
+		m_type = header.type;
 
-		if (m_type == 1) { m_status = NotSupportIndexedColor; goto end; }
-		if (m_type != 2 && m_type != 3) { m_status = NotSupportCompressedFormat; goto end; }
-		if (m_bitsPerPixel != 24 && m_bitsPerPixel != 32) { m_status = InvalidBitsPerPixel; goto end; }
+		m_status = header.validate(file.size());
+		if (m_status != Okay) return;
 
-		loadBody(file);
+		m_status = loadBody(header, file.data(), file.data() + file.size());
+		if (m_status != Okay)
+		{
+			delete[] m_data;
+			m_data = NULL;
+		}
+	}
 
-		m_status = Okay;
-		
-		end:
-		fclose(file);
+	Tga(Tga&& other) : m_width(other.m_width), m_height(other.m_height), m_channels(other.m_channels),
+		m_type(other.m_type), m_data(other.m_data), m_status(other.m_status)
+	{
+		other.m_data = NULL;
 	}
 
 	~Tga()
@@ -50,47 +170,155 @@ public:
 	const unsigned char* data() const { return m_data; }
 	auto okay() const { return m_status == Okay; }
 	auto status() const { return m_status; }
-	auto hasAlpha() const { return m_bitsPerPixel == 32; };
+	auto hasAlpha() const { return m_channels == 4; };
 
 private:
-	void loadHeader(FILE* file)
+	// Decodes straight into m_data, which is what gets uploaded
+	Status loadBody(const Header& header, const unsigned char* file, const unsigned char* end)
 	{
-		unsigned char cGarbage;
-		short iGarbage;
+		const size_t count = (size_t)m_width * m_height;
+		m_data = new unsigned char[count * m_channels];
 
-		fread(&cGarbage, sizeof(cGarbage), 1, file);
-		fread(&cGarbage, sizeof(cGarbage), 1, file);
+		m_sourceType = header.baseType();
+		m_sourceBytes = header.bitsPerPixel / 8;
+		if (m_sourceType == ImageColorMapped)
+			loadPalette(header, file + header.colorMapOffset());
 
-		fread(&m_type, sizeof(m_type), 1, file);
+		auto pixels = file + header.pixelOffset();
+		if (!header.compressed())
+		{
+			convert(pixels, m_data, count);
+			return Okay;
+		}
+		return decodeRunLength(pixels, end, count);
+	}
 
-		fread(&iGarbage, sizeof(iGarbage), 1, file);
-		fread(&iGarbage, sizeof(iGarbage), 1, file);
-		fread(&cGarbage, sizeof(cGarbage), 1, file);
-		fread(&iGarbage, sizeof(iGarbage), 1, file);
-		fread(&iGarbage, sizeof(iGarbage), 1, file);
+	// Converts the color map to the output layout, padded to every possible
+	// index so lookups need no bounds check; unmapped indices read black.
+	void loadPalette(const Header& header, const unsigned char* colorMap)
+	{
+		const int entryBytes = header.colorMapBits / 8;
+		m_palette.assign(((size_t)1 << header.bitsPerPixel) * m_channels, 0);
+		auto first = (std::min)((size_t)header.colorMapFirst, ((size_t)1 << header.bitsPerPixel));
+		auto length = (std::min)((size_t)header.colorMapLength, ((size_t)1 << header.bitsPerPixel) - first);
+		Swizzle::swap(colorMap, m_palette.data() + first * m_channels, length, entryBytes);
+	}
 
-		fread(&m_width, sizeof(m_width), 1, file);
-		fread(&m_height, sizeof(m_height), 1, file);
-		fread(&m_bitsPerPixel, sizeof(m_bitsPerPixel), 1, file);
+	// Each packet is a header byte and either one pixel repeated (high bit set)
+	// or a run of literal pixels, 1 to 128 of them. Packets may cross scanlines.
+	Status decodeRunLength(const unsigned char* src, const unsigned char* end, size_t count)
+	{
+		auto dst = m_data;
+		const auto dstEnd = m_data + count * m_channels;
+		while (dst < dstEnd)
+		{
+			if (src >= end) return TruncatedFile;
+			const unsigned char packet = *src++;
+			size_t run = (packet & 0x7f) + 1;
+			run = (std::min)(run, (size_t)(dstEnd - dst) / m_channels);
 
-		fread(&cGarbage, sizeof(cGarbage), 1, file);
+			if (packet & 0x80)
+			{
+				if (end - src < m_sourceBytes) return TruncatedFile;
+				convert(src, dst, 1);
+				src += m_sourceBytes;
+				if (m_channels == 4) fill<4>(dst, run);
+				else fill<3>(dst, run);
+			}
+			else
+			{
+				if ((size_t)(end - src) < run * m_sourceBytes) return TruncatedFile;
+				convert(src, dst, run);
+				src += run * m_sourceBytes;
+			}
+			dst += run * m_channels;
+		}
+		return Okay;
 	}
 
-	void loadBody(FILE* file)
+	void convert(const unsigned char* src, unsigned char* dst, size_t count)
 	{
-		int channels = m_bitsPerPixel / 8;
-		int total = m_width * m_height * channels;
-		m_data = new unsigned char[total];
+		switch (m_sourceType)
+		{
+		case ImageTrueColor:
+			// TGA stores data as BGR(A) so we have to swap R and B
+			Swizzle::swap(src, dst, count, m_channels);
+			break;
+		case ImageGrayscale:
+			if (m_channels == 4) expandGray<4>(src, dst, count);
+			else expandGray<3>(src, dst, count);
+			break;
+		case ImageColorMapped:
+			if (m_sourceBytes == 2) lookup<2>(src, dst, count);
+			else if (m_channels == 4) lookup<1, 4>(src, dst, count);
+			else lookup<1, 3>(src, dst, count);
+			break;
+		}
+	}
 
-		fread(m_data, 1, total, file);
+	// Repeats the first pixel at dst over the rest of the run. Fixed sizes here
+	// and below let the compiler turn the per-pixel copies into plain moves.
+	template <int Channels>
+	static void fill(unsigned char* dst, size_t run)
+	{
+		for (size_t i = 1; i < run; ++i)
+			memcpy(dst + i * Channels, dst, Channels);
+	}
 
-		// TGA stores data as BGR(A) so we have to swap R and B
-		for (int i = 0; i < total; i += channels)
+	template <int Channels>
+	static void expandGray(const unsigned char* src, unsigned char* dst, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i, src += Channels - 2, dst += Channels)
 		{
-			auto tmp = m_data[i];
-			m_data[i] = m_data[i + 2];
-			m_data[i + 2] = tmp;
+			dst[0] = dst[1] = dst[2] = src[0];
+			if (Channels == 4) dst[3] = src[1];
 		}
 	}
 
+	template <int IndexBytes, int Channels = 0>
+	void lookup(const unsigned char* src, unsigned char* dst, size_t count) const
+	{
+		const size_t channels = Channels ? Channels : m_channels;
+		auto palette = m_palette.data();
+		for (size_t i = 0; i < count; ++i, src += IndexBytes, dst += channels)
+		{
+			size_t index = IndexBytes == 2 ? (src[0] | (src[1] << 8)) : src[0];
+			memcpy(dst, palette + index * channels, Channels ? Channels : channels);
+		}
+	}
+
+};
+
+// Zero-copy access to a raw true-color TGA: the pixels stay in the file
+// mapping, in the file's BGR(A) order, for as long as the view lives.
+// Other image types report NotSupportIndexedColor or NotSupportCompressedFormat;
+// load those with Tga. "Benchmarks tga" times both against fread.
+class TgaView
+{
+private:
+	MappedFile m_file;
+	Tga::Header m_header;
+	Tga::Status m_status;
+
+public:
+	TgaView(const char* filePath) : m_file(filePath)
+	{
+		memset(&m_header, 0, sizeof(m_header));
+		if (!m_file.okay()) { m_status = Tga::CouldNotOpenFile; return; }
+		if (!m_header.parse(m_file.data(), m_file.size())) { m_status = Tga::TruncatedFile; return; }
+		m_status = m_header.validate(m_file.size());
+		if (m_status == Tga::Okay && m_header.baseType() == Tga::ImageColorMapped) m_status = Tga::NotSupportIndexedColor;
+		else if (m_status == Tga::Okay && m_header.type != Tga::ImageTrueColor) m_status = Tga::NotSupportCompressedFormat;
+	}
+
+	int width() const { return m_header.width; }
+	int height() const { return m_header.height; }
+	int channels() const { return m_header.bitsPerPixel / 8; }
+	bool hasAlpha() const { return m_header.bitsPerPixel == 32; }
+	bool okay() const { return m_status == Tga::Okay; }
+	Tga::Status status() const { return m_status; }
+
+	// Rows start at the bottom unless the header says otherwise, same as Tga::data()
+	const unsigned char* bgrData() const { return m_file.data() + m_header.pixelOffset(); }
+	size_t size() const { return m_header.pixelSize(); }
 };
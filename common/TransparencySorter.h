@@ -0,0 +1,178 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Keeps translucent primitives in back to front order from frame to frame,
+// for normal alpha blending, which unlike additive blending depends on the
+// order draws land in. Depths change little between frames, so last frame's
+// order is nearly sorted already and an insertion sort over it runs in about
+// one pass. When the view jumps and the insertion sort has moved more than
+// MOVE_BUDGET entries per primitive, it stops and a radix sort over the
+// depth bits finishes, so a bad frame costs about what sorting from scratch
+// would. Both are stable, so equal depths do not flicker. "Benchmarks sorter"
+// times both paths against std::stable_sort.
+//
+//	m_sorter.sort(depths.data(), triangleCount);
+//	if (m_sorter.changed())
+//		m_sorter.writeIndices(indices, 3, sortedIndices.data());
+class TransparencySorter
+{
+public:
+	// Insertion sort moves allowed per primitive before falling back to radix
+	static const size_t MOVE_BUDGET = 16;
+
+	struct Counters
+	{
+		int insertion;    // frames finished by the insertion sort
+		int radix;        // frames that fell back to the radix sort
+	};
+
+private:
+	// [0] holds the keys and primitive indices, back to front after sort(); [1] is scratch
+	std::vector<uint32_t> m_keys[2];
+	std::vector<uint32_t> m_order[2];
+	size_t m_lastMoves;
+	bool m_changed;
+	Counters m_counters;
+
+	TransparencySorter(const TransparencySorter&);
+	TransparencySorter& operator = (const TransparencySorter&);
+
+public:
+	TransparencySorter() : m_lastMoves(0), m_changed(false)
+	{
+		m_counters = { 0, 0 };
+	}
+
+	// depths[i] is primitive i's distance from the eye, e.g. of its centroid;
+	// larger is farther and drawn first. A new count starts over from scratch.
+	void sort(const float* depths, size_t count)
+	{
+		auto& keys = m_keys[0];
+		auto& order = m_order[0];
+		m_changed = order.size() != count;
+		if (m_changed)
+		{
+			order.resize(count);
+			for (size_t i = 0; i < count; ++i)
+				order[i] = (uint32_t)i;
+		}
+
+		// Far first means descending depth, so the keys are inverted
+		keys.resize(count);
+		for (size_t i = 0; i < count; ++i)
+			keys[i] = ~key(depths[order[i]]);
+
+		m_lastMoves = 0;
+		if (insertionSort(count * MOVE_BUDGET))
+		{
+			++m_counters.insertion;
+		}
+		else
+		{
+			radixSort();
+			++m_counters.radix;
+			m_changed = true;
+		}
+		m_changed = m_changed || m_lastMoves > 0;
+	}
+
+	// Copies each primitive's indices into out, back to front; indices holds
+	// perPrimitive indices for each primitive in its original order
+	template <typename Index>
+	void writeIndices(const Index* indices, int perPrimitive, Index* out) const
+	{
+		for (auto primitive : m_order[0])
+		{
+			memcpy(out, indices + (size_t)primitive * perPrimitive, perPrimitive * sizeof(Index));
+			out += perPrimitive;
+		}
+	}
+
+	// Primitive indices, back to front
+	const std::vector<uint32_t>& order() const { return m_order[0]; }
+	// Whether the last sort() changed the order, i.e. whether the indices need rewriting
+	bool changed() const { return m_changed; }
+	size_t lastMoves() const { return m_lastMoves; }
+	const Counters& counters() const { return m_counters; }
+
+private:
+	// Maps a float to an unsigned int with the same order, negatives included
+	static uint32_t key(float depth)
+	{
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+
+	// Returns false, leaving the keys partly sorted, once more than budget
+	// entries have moved
+	bool insertionSort(size_t budget)
+	{
+		auto& keys = m_keys[0];
+		auto& order = m_order[0];
+		for (size_t i = 1; i < keys.size(); ++i)
+		{
+			auto k = keys[i];
+			if (keys[i - 1] <= k) continue;
+			auto primitive = order[i];
+			size_t j = i;
+			for (; j > 0 && keys[j - 1] > k; --j)
+			{
+				keys[j] = keys[j - 1];
+				order[j] = order[j - 1];
+			}
+			keys[j] = k;
+			order[j] = primitive;
+			m_lastMoves += i - j;
+			if (m_lastMoves > budget) return false;
+		}
+		return true;
+	}
+
+	// LSD over 8 bit digits, skipping the digits all keys share; see RenderQueue
+	void radixSort()
+	{
+		const size_t count = m_keys[0].size();
+		m_keys[1].resize(count);
+		m_order[1].resize(count);
+
+		size_t histograms[4][256] = {};
+		for (auto k : m_keys[0])
+		{
+			for (int digit = 0; digit < 4; ++digit)
+				++histograms[digit][(k >> (digit * 8)) & 0xff];
+		}
+
+		const auto first = m_keys[0][0];
+		for (int digit = 0; digit < 4; ++digit)
+		{
+			const int shift = digit * 8;
+			auto& histogram = histograms[digit];
+			if (histogram[(first >> shift) & 0xff] == count)
+				continue;
+
+			size_t offsets[256];
+			size_t sum = 0;
+			for (int i = 0; i < 256; ++i)
+			{
+				offsets[i] = sum;
+				sum += histogram[i];
+			}
+
+			auto& keys = m_keys[0];
+			auto& order = m_order[0];
+			for (size_t i = 0; i < count; ++i)
+			{
+				auto slot = offsets[(keys[i] >> shift) & 0xff]++;
+				m_keys[1][slot] = keys[i];
+				m_order[1][slot] = order[i];
+			}
+			m_keys[0].swap(m_keys[1]);
+			m_order[0].swap(m_order[1]);
+		}
+	}
+};
@@ -1,26 +1,57 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 #include <GLES2/gl2.h>
 
 class Utils
 {
 public:
 
+	// Milliseconds from an arbitrary starting point
 	static unsigned int currentTime()
 	{
-		return GetTickCount();
+		return (unsigned int)std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
 	}
 
+	// Gives a Win32 GUI process a console for printf; elsewhere stdout is
+	// already the terminal.
 	static void showConsole()
 	{
+#ifdef _WIN32
 		AllocConsole();
 		freopen("con", "w", stdout);
 		freopen("con", "w", stderr);
+#endif
+	}
+
+	// True if name is a whole word in the space-separated extensions list
+	static bool hasExtension(const char* extensions, const char* name)
+	{
+		if (!extensions) return false;
+		const auto length = strlen(name);
+		for (auto p = strstr(extensions, name); p; p = strstr(p + length, name))
+		{
+			if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+				return true;
+		}
+		return false;
+	}
+
+	// Needs a current context
+	static bool hasExtension(const char* name)
+	{
+		return hasExtension((const char*)glGetString(GL_EXTENSIONS), name);
 	}
 
 	static GLuint compileShader(const std::string& source, GLenum type)
@@ -29,11 +60,42 @@ public:
 		auto src = source.c_str();
 		glShaderSource(shader, 1, &src, NULL);
 		glCompileShader(shader);
+
+		if (checkShader(shader, type)) return shader;
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	// attributes[i], if given, is bound to location i
+	static GLuint linkProgram(GLuint vs, GLuint fs, const std::vector<std::string>& attributes = std::vector<std::string>())
+	{
+		auto program = glCreateProgram();
+		
+		glAttachShader(program, vs);
+		glAttachShader(program, fs);
+		bindAttributes(program, attributes);
 		
+		glLinkProgram(program);
+		
+		if (checkProgram(program)) return program;
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	// Binds attributes[i] to location i; takes effect at the next link
+	static void bindAttributes(GLuint program, const std::vector<std::string>& attributes)
+	{
+		for (size_t i = 0; i < attributes.size(); ++i)
+			glBindAttribLocation(program, (GLuint)i, attributes[i].c_str());
+	}
+
+	// Waits for the compile if it is still running; prints the log if it failed
+	static bool checkShader(GLuint shader, GLenum type)
+	{
 		GLint compiledOkay;
 		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiledOkay);
 
-		if (compiledOkay) return shader;
+		if (compiledOkay) return true;
 
 		GLint infoLen = 0;
 		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
@@ -44,22 +106,15 @@ public:
 			printf("Error compiling %s shader:\n%s\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment", infoLog);
 			delete[] infoLog;
 		}
-		glDeleteShader(shader);
-		return 0;
+		return false;
 	}
 
-	static GLuint linkProgram(GLuint vs, GLuint fs)
+	// Waits for the link if it is still running; prints the log if it failed
+	static bool checkProgram(GLuint program)
 	{
-		auto program = glCreateProgram();
-		
-		glAttachShader(program, vs);
-		glAttachShader(program, fs);
-		
-		glLinkProgram(program);
-		
 		GLint linkedOkay;
 		glGetProgramiv(program, GL_LINK_STATUS, &linkedOkay);
-		if (linkedOkay) return program;
+		if (linkedOkay) return true;
 		
 		GLint infoLen = 0;
 		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLen);
@@ -70,8 +125,24 @@ public:
 			printf("Error linking program:\n%s\n", infoLog);
 			delete[] infoLog;
 		}
-		glDeleteProgram(program);
-		return 0;
+		return false;
+	}
+
+	// The environment variable's value, or "" when it is not set
+	static std::string environment(const char* name)
+	{
+#ifdef _WIN32
+		// getenv is deprecated under /sdl
+		char* value = NULL;
+		size_t length = 0;
+		if (_dupenv_s(&value, &length, name) != 0 || !value) return "";
+		std::string result(value);
+		free(value);
+		return result;
+#else
+		auto value = getenv(name);
+		return value ? value : "";
+#endif
 	}
 
 	static std::string readFile(const char* filePath)
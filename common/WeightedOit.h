@@ -0,0 +1,225 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <cassert>
+#include "Utils.h"
+#include "GpuBuffer.h"
+#include "GlStateCache.h"
+#include "ShaderProgram.h"
+
+// Weighted blended order independent transparency (McGuire and Bavoil 2013):
+// translucent fragments are summed into an accumulation target, weighted so
+// near ones count more, while a revealage target multiplies up how much of
+// the background still shows through. composite() then lays the weighted
+// average colour over the frame. Nothing is sorted, so the cost does not
+// grow with how the geometry overlaps; the price is an approximate result
+// where many layers of similar depth and high opacity overlap. "Benchmarks
+// oit" compares its frame time with sorted alpha blending.
+//
+// GLES 2.0 has no multiple render targets, so the translucent geometry is
+// drawn twice, once into each target; the shader tells the passes apart by a
+// uniform. In the accumulation pass it outputs
+//	vec4(colour * alpha, alpha) * weight
+// and in the revealage pass just alpha. Accumulating needs a blendable half
+// float target (GL_EXT_color_buffer_half_float); see supported().
+//
+//	m_oit.resize(width, height);
+//	m_oit.beginAccumulation(m_state);  ...draw translucent geometry...
+//	m_oit.beginRevealage(m_state);     ...draw it again...
+//	m_oit.composite(m_state);
+//
+// composite() returns to the framebuffer that was bound, and restores the
+// clear colour that was set, when resize() last created the targets, so
+// nothing is read back from GL per frame; resize() again after changing
+// either. The targets have no depth buffer, so translucent draws are not
+// tested against opaque ones. composite() draws with an attribute array of its own,
+// which may share a location with the caller's, so re-specify vertex
+// attributes after it.
+class WeightedOit
+{
+private:
+	enum Target { Accumulation, Revealage, TARGET_COUNT };
+
+	GLuint m_textures[TARGET_COUNT];
+	GLuint m_framebuffers[TARGET_COUNT];
+	int m_width, m_height;
+
+	ShaderProgram m_composite;
+	GpuBuffer m_triangle;
+	GLint m_positionLocation;
+
+	// What resize() found bound and set, restored by composite()
+	GLint m_framebuffer;
+	GLfloat m_clearColor[4];
+
+	WeightedOit(const WeightedOit&);
+	WeightedOit& operator = (const WeightedOit&);
+
+public:
+	WeightedOit() : m_width(0), m_height(0), m_positionLocation(-1), m_framebuffer(0)
+	{
+		for (int i = 0; i < TARGET_COUNT; ++i)
+			m_textures[i] = m_framebuffers[i] = 0;
+		for (int i = 0; i < 4; ++i)
+			m_clearColor[i] = 0.0f;
+	}
+
+	~WeightedOit()
+	{
+		release();
+	}
+
+	// Needs a current context
+	static bool supported()
+	{
+		return Utils::hasExtension("GL_OES_texture_half_float") && Utils::hasExtension("GL_EXT_color_buffer_half_float");
+	}
+
+	// (Re)creates the targets at the frame's size, doing nothing if it has not
+	// changed. False if the driver cannot render to them after all.
+	bool resize(int width, int height)
+	{
+		if (m_framebuffers[0] && width == m_width && height == m_height) return true;
+		release();
+		m_width = width;
+		m_height = height;
+		if (!m_composite.id()) createComposite();
+
+		GLint texture;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_framebuffer);
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, m_clearColor);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+
+		glGenTextures(TARGET_COUNT, m_textures);
+		glGenFramebuffers(TARGET_COUNT, m_framebuffers);
+		auto complete = true;
+		for (int i = 0; i < TARGET_COUNT; ++i)
+		{
+			glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			// Revealage is a product of (1 - alpha) terms, which 8 bits hold well enough
+			auto type = i == Accumulation ? GL_HALF_FLOAT_OES : GL_UNSIGNED_BYTE;
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, type, NULL);
+
+			glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[i]);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_textures[i], 0);
+			complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		if (!complete) release();
+		return complete;
+	}
+
+	// Binds the accumulation target and sets additive blending; draw the
+	// translucent geometry with blending enabled and depth writes off
+	void beginAccumulation(GlStateCache& state)
+	{
+		assert(m_framebuffers[0]);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[Accumulation]);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		state.blendFunc(GL_ONE, GL_ONE);
+	}
+
+	// Binds the revealage target, which starts at 1 and is multiplied by
+	// (1 - alpha) for every fragment
+	void beginRevealage(GlStateCache& state)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffers[Revealage]);
+		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		state.blendFunc(GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+	}
+
+	// Rebinds the frame's framebuffer and clear colour and blends the average translucent
+	// colour over it, by one minus the revealage
+	void composite(GlStateCache& state)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glClearColor(m_clearColor[0], m_clearColor[1], m_clearColor[2], m_clearColor[3]);
+
+		state.useProgram(m_composite.id());
+		for (int i = 0; i < TARGET_COUNT; ++i)
+		{
+			state.activeTexture(GL_TEXTURE0 + i);
+			state.bindTexture(GL_TEXTURE_2D, m_textures[i]);
+		}
+		state.activeTexture(GL_TEXTURE0);
+		state.enable(GL_BLEND, true);
+		state.enable(GL_DEPTH_TEST, false);
+		state.blendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+		state.bindBuffer(GL_ARRAY_BUFFER, m_triangle.id());
+		glVertexAttribPointer(m_positionLocation, 2, GL_FLOAT, GL_FALSE, 0, GpuBuffer::offset(0));
+		glEnableVertexAttribArray(m_positionLocation);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glDisableVertexAttribArray(m_positionLocation);
+	}
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+private:
+	void release()
+	{
+		if (m_framebuffers[0]) glDeleteFramebuffers(TARGET_COUNT, m_framebuffers);
+		if (m_textures[0]) glDeleteTextures(TARGET_COUNT, m_textures);
+		for (int i = 0; i < TARGET_COUNT; ++i)
+			m_textures[i] = m_framebuffers[i] = 0;
+	}
+
+	void createComposite()
+	{
+		static const char* vsSource =
+			"attribute vec2 a_position;\n"
+			"varying vec2 v_texCoord;\n"
+			"void main()\n"
+			"{\n"
+			"	gl_Position = vec4(a_position, 0.0, 1.0);\n"
+			"	v_texCoord = a_position * 0.5 + 0.5;\n"
+			"}\n";
+		// Alpha carries the revealage, for GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA
+		static const char* fsSource =
+			"precision mediump float;\n"
+			"varying vec2 v_texCoord;\n"
+			"uniform sampler2D u_accumulation;\n"
+			"uniform sampler2D u_revealage;\n"
+			"void main()\n"
+			"{\n"
+			"	vec4 accumulation = texture2D(u_accumulation, v_texCoord);\n"
+			"	float revealage = texture2D(u_revealage, v_texCoord).r;\n"
+			"	gl_FragColor = vec4(accumulation.rgb / max(accumulation.a, 0.00001), revealage);\n"
+			"}\n";
+
+		auto vs = Utils::compileShader(vsSource, GL_VERTEX_SHADER);
+		auto fs = Utils::compileShader(fsSource, GL_FRAGMENT_SHADER);
+		assert(vs && fs);
+		auto program = Utils::linkProgram(vs, fs);
+		assert(program);
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+
+		GLint current;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		m_composite.reset(program);
+		m_composite.use();
+		m_composite.set(m_composite.uniform(ShaderProgram::hash("u_accumulation")), Accumulation);
+		m_composite.set(m_composite.uniform(ShaderProgram::hash("u_revealage")), Revealage);
+		glUseProgram(current);
+		m_positionLocation = m_composite.attribute(ShaderProgram::hash("a_position"));
+		assert(m_positionLocation >= 0);
+
+		// One triangle covering the screen, without a diagonal seam
+		static const float corners[] = { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+		GLint arrayBuffer;
+		glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &arrayBuffer);
+		m_triangle.upload(GL_ARRAY_BUFFER, corners, sizeof(corners));
+		glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
+	}
+};
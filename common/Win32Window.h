@@ -0,0 +1,125 @@
+#pragma once
+
+// Included by Window.h.
+
+#include <Windows.h>
+#include <cassert>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+
+class Win32Window : public Window
+{
+private:
+	HWND m_hwnd;
+	// Whether open() raised the timer resolution, for the destructor to lower it again
+	bool m_timerPeriodSet;
+
+public:
+	Win32Window(HINSTANCE hInst, int width, int height, bool resizable, const char* title) : Window(width, height), m_timerPeriodSet(false)
+	{
+		auto WIN_CLASS = "WinClass";
+		WNDCLASS wClass = { 0 };
+		wClass.hCursor = LoadCursor(NULL, IDC_ARROW);
+		wClass.hInstance = hInst;
+		wClass.lpfnWndProc = (WNDPROC)internalWindProc;
+		wClass.lpszClassName = WIN_CLASS;
+
+		auto okay = RegisterClass(&wClass);
+		assert(okay);
+
+		int dwStyle = WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU;
+		if (resizable) dwStyle |= WS_SIZEBOX | WS_MAXIMIZEBOX;
+
+		RECT rect; rect.left = 0; rect.top = 0; rect.right = width; rect.bottom = height;
+		auto adjustWindowRectOkay = AdjustWindowRect(&rect, dwStyle, FALSE);
+		assert(adjustWindowRectOkay);
+
+		const int windowWidth = rect.right - rect.left;
+		const int windowHeight = rect.bottom - rect.top;
+
+		const int screenWidth = GetSystemMetrics(SM_CXSCREEN);
+		const int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+
+		m_hwnd = CreateWindow(
+			WIN_CLASS,
+			title,
+			dwStyle,
+			(screenWidth - windowWidth) / 2,
+			(screenHeight - windowHeight) / 2,
+			windowWidth,
+			windowHeight,
+			NULL,
+			NULL,
+			hInst,
+			NULL
+		);
+		assert(m_hwnd);
+		SetWindowLongPtr(m_hwnd, GWLP_USERDATA, (LONG_PTR)this);
+	}
+
+	~Win32Window()
+	{
+		if (m_timerPeriodSet) timeEndPeriod(1);
+		DestroyWindow(m_hwnd);
+	}
+
+	void* surface()
+	{
+		return m_hwnd;
+	}
+
+protected:
+	void open()
+	{
+		// 1 ms scheduler resolution, so FramePacer's sleeps do not overshoot by a 15.6 ms tick
+		m_timerPeriodSet = timeBeginPeriod(1) == TIMERR_NOERROR;
+		ShowWindow(m_hwnd, SW_SHOWDEFAULT);
+	}
+
+	bool processEvents()
+	{
+		MSG msg;
+		while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		{
+			if (msg.message == WM_QUIT)
+				return false;
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
+		return true;
+	}
+
+private:
+	static LRESULT CALLBACK internalWindProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		auto window = (Win32Window*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+		// Messages sent from inside CreateWindow arrive before the pointer is set
+		if (!window) return DefWindowProc(hwnd, msg, wParam, lParam);
+		return window->windProc(hwnd, msg, wParam, lParam);
+	}
+
+	LRESULT CALLBACK windProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		switch (msg)
+		{
+		case WM_DESTROY:
+		{
+			PostQuitMessage(0);
+			return 0;
+		}
+		case WM_SIZE:
+		{
+			resized(LOWORD(lParam), HIWORD(lParam));
+			return 0;
+		}
+		case WM_KEYDOWN:
+		{
+			// Key values are the virtual-key codes
+			keyDown((int)wParam);
+			return 0;
+		}
+		}
+		return DefWindowProc(hwnd, msg, wParam, lParam);
+	}
+
+};
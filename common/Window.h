@@ -1,129 +1,97 @@
 #pragma once
 
-#include <Windows.h>
 #include "WindowListener.h"
-#include <cassert>
-
+#include "FramePacer.h"
+#include <memory>
+#include <stdlib.h>
+
+// Platform-neutral window. Backends:
+//   Win32Window  Windows
+//   X11Window    Linux and other X11 systems
+//   NullWindow   no window at all; pumps WindowListener::tick() as fast as
+//                possible for benchmarks and CI, rendering through a headless
+//                Graphic. Chosen when WINDOW_NULL is defined, or at runtime on
+//                X11 systems when $DISPLAY is not set.
+// Include this header rather than a backend header; it pulls the backends in.
 class Window
 {
-private:
-	HWND m_hwnd;
+protected:
+	int m_width, m_height;
 	WindowListener* m_listener;
+	FramePacer m_pacer;
 
 public:
-	Window(HINSTANCE hInst, int width, int height, bool resizable, const char* title) : m_listener(NULL)
-	{
-		auto WIN_CLASS = "WinClass";
-		WNDCLASS wClass = { 0 };
-		wClass.hCursor = LoadCursor(NULL, IDC_ARROW);
-		wClass.hInstance = hInst;
-		wClass.lpfnWndProc = (WNDPROC)internalWindProc;
-		wClass.lpszClassName = WIN_CLASS;
-
-		auto okay = RegisterClass(&wClass);
-		assert(okay);
-
-		int dwStyle = WS_CAPTION | WS_MINIMIZEBOX | WS_SYSMENU;
-		if (resizable) dwStyle |= WS_SIZEBOX | WS_MAXIMIZEBOX;
-
-		RECT rect; rect.left = 0; rect.top = 0; rect.right = width; rect.bottom = height;
-		auto adjustWindowRectOkay = AdjustWindowRect(&rect, dwStyle, FALSE);
-		assert(adjustWindowRectOkay);
-
-		const int windowWidth = rect.right - rect.left;
-		const int windowHeight = rect.bottom - rect.top;
-
-		const int screenWidth = GetSystemMetrics(SM_CXSCREEN);
-		const int screenHeight = GetSystemMetrics(SM_CYSCREEN);
-
-		m_hwnd = CreateWindow(
-			WIN_CLASS,
-			title,
-			dwStyle,
-			(screenWidth - windowWidth) / 2,
-			(screenHeight - windowHeight) / 2,
-			windowWidth,
-			windowHeight,
-			NULL,
-			NULL,
-			hInst,
-			NULL
-		);
-		assert(m_hwnd);
-		SetWindowLongPtr(m_hwnd, GWLP_USERDATA, (LONG_PTR)this);
-	}
+	Window(int width, int height) : m_width(width), m_height(height), m_listener(NULL) { }
+	virtual ~Window() { }
 
-	~Window()
-	{
-		DestroyWindow(m_hwnd);
-	}
+	static std::unique_ptr<Window> create(int width, int height, bool resizable, const char* title);
 
-	HWND surface()
-	{
-		return m_hwnd;
-	}
+	int width() const { return m_width; }
+	int height() const { return m_height; }
 
-	void show(int fps, WindowListener* listener, int nCmdShow)
-	{
-		m_listener = listener;
+	// Native display for eglGetDisplay, or NULL for EGL_DEFAULT_DISPLAY.
+	virtual void* display() { return NULL; }
 
-		MSG msg;
-		ZeroMemory(&msg, sizeof(MSG));
+	// Native window for eglCreateWindowSurface, or NULL if there is none.
+	virtual void* surface() = 0;
 
-		auto last = GetTickCount();
-		const unsigned long frameTime = 1000 / fps;
+	// Runs the event loop, calling listener->tick() fps times per second
+	// (as fast as possible if fps <= 0) until it returns false or the window
+	// is closed, then prints the achieved frame times.
+	virtual void show(int fps, WindowListener* listener)
+	{
+		m_listener = listener;
+		m_pacer.setFps(fps);
+		open();
 
-		ShowWindow(m_hwnd, nCmdShow);
-		while (true)
+		while (processEvents())
 		{
-			if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
-			{
-				if (msg.message == WM_QUIT)
-					break;
-				TranslateMessage(&msg);
-				DispatchMessage(&msg);
-			}
-			else
-			{
-				auto current = GetTickCount();
-				auto duration = current - last;
-				if (duration < frameTime)
-					Sleep(frameTime - duration);
-				last = GetTickCount();
-				if (!m_listener->tick())
-					break;
-			}
+			m_pacer.wait();
+			if (!m_listener->tick())
+				break;
 		}
+		m_pacer.report();
 	}
-	
-private:
-	static LRESULT CALLBACK internalWindProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+
+	const FramePacer& pacer() const { return m_pacer; }
+
+protected:
+	// Makes the window visible.
+	virtual void open() { }
+
+	// Dispatches pending events without blocking. Returns false once the
+	// window has been closed.
+	virtual bool processEvents() = 0;
+
+	void resized(int newWidth, int newHeight)
 	{
-		auto window = (Window*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
-		return window->windProc(hwnd, msg, wParam, lParam);
+		m_width = newWidth;
+		m_height = newHeight;
+		if (m_listener) m_listener->onResized(newWidth, newHeight);
 	}
 
-	LRESULT CALLBACK windProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	void keyDown(int keycode)
 	{
-		switch (msg)
-		{
-		case WM_DESTROY:
-		{
-			PostQuitMessage(0);
-			return 0;
-		}
-		case WM_SIZE:
-		{
-			if (m_listener) m_listener->onResized(LOWORD(lParam), HIWORD(lParam));
-			return 0;
-		}
-		case WM_KEYDOWN:
-		{
-			if (m_listener) m_listener->onKeyDown(wParam);
-			return 0;
-		}
-		}
-		return DefWindowProc(hwnd, msg, wParam, lParam);
+		if (m_listener) m_listener->onKeyDown(keycode);
 	}
-
 };
+
+#include "NullWindow.h"
+#if defined(_WIN32)
+#include "Win32Window.h"
+#elif !defined(WINDOW_NULL)
+#include "X11Window.h"
+#endif
+
+inline std::unique_ptr<Window> Window::create(int width, int height, bool resizable, const char* title)
+{
+#if defined(WINDOW_NULL)
+	return std::unique_ptr<Window>(new NullWindow(width, height));
+#elif defined(_WIN32)
+	return std::unique_ptr<Window>(new Win32Window(GetModuleHandle(NULL), width, height, resizable, title));
+#else
+	if (!getenv("DISPLAY"))
+		return std::unique_ptr<Window>(new NullWindow(width, height));
+	return std::unique_ptr<Window>(new X11Window(width, height, resizable, title));
+#endif
+}
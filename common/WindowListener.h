@@ -1,5 +1,21 @@
 #pragma once
 
+// Key codes passed to onKeyDown. The values are the Win32 virtual-key codes,
+// and letters and digits arrive as their uppercase ASCII ('A', '7'), so every
+// Window backend reports the same codes.
+enum Key
+{
+	KEY_BACKSPACE = 0x08,
+	KEY_TAB = 0x09,
+	KEY_ENTER = 0x0D,
+	KEY_ESCAPE = 0x1B,
+	KEY_SPACE = 0x20,
+	KEY_LEFT = 0x25,
+	KEY_UP = 0x26,
+	KEY_RIGHT = 0x27,
+	KEY_DOWN = 0x28
+};
+
 class WindowListener
 {
 public:
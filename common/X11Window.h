@@ -0,0 +1,126 @@
+#pragma once
+
+// Included by Window.h.
+
+// Xlib declares a global type named Window and macros such as Status and Bool
+// that clash with this code base, so its names are kept out of the way here.
+#define Window XlibWindow
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+#undef Window
+#undef Status
+#undef Bool
+#undef True
+#undef False
+#undef None
+
+#include <cassert>
+#include <stdint.h>
+
+class X11Window : public Window
+{
+private:
+	Display* m_display;
+	XlibWindow m_window;
+	Atom m_deleteMessage;
+
+public:
+	X11Window(int width, int height, bool resizable, const char* title) : Window(width, height)
+	{
+		m_display = XOpenDisplay(NULL);
+		assert(m_display);
+
+		const auto screen = DefaultScreen(m_display);
+		m_window = XCreateSimpleWindow(m_display, RootWindow(m_display, screen), 0, 0, width, height, 0,
+			BlackPixel(m_display, screen), BlackPixel(m_display, screen));
+		assert(m_window);
+
+		XSelectInput(m_display, m_window, KeyPressMask | StructureNotifyMask);
+		XStoreName(m_display, m_window, title);
+
+		// Ask the window manager for a ClientMessage instead of killing the connection on close
+		m_deleteMessage = XInternAtom(m_display, "WM_DELETE_WINDOW", 0);
+		XSetWMProtocols(m_display, m_window, &m_deleteMessage, 1);
+
+		if (!resizable)
+		{
+			XSizeHints hints = { 0 };
+			hints.flags = PMinSize | PMaxSize;
+			hints.min_width = hints.max_width = width;
+			hints.min_height = hints.max_height = height;
+			XSetWMNormalHints(m_display, m_window, &hints);
+		}
+	}
+
+	~X11Window()
+	{
+		XDestroyWindow(m_display, m_window);
+		XCloseDisplay(m_display);
+	}
+
+	void* display()
+	{
+		return m_display;
+	}
+
+	void* surface()
+	{
+		return (void*)(uintptr_t)m_window;
+	}
+
+protected:
+	void open()
+	{
+		XMapWindow(m_display, m_window);
+		XFlush(m_display);
+	}
+
+	bool processEvents()
+	{
+		while (XPending(m_display))
+		{
+			XEvent event;
+			XNextEvent(m_display, &event);
+			switch (event.type)
+			{
+			case ClientMessage:
+				if ((Atom)event.xclient.data.l[0] == m_deleteMessage)
+					return false;
+				break;
+			case ConfigureNotify:
+				if (event.xconfigure.width != m_width || event.xconfigure.height != m_height)
+					resized(event.xconfigure.width, event.xconfigure.height);
+				break;
+			case KeyPress:
+			{
+				auto keycode = translateKey(XLookupKeysym(&event.xkey, 0));
+				if (keycode) keyDown(keycode);
+				break;
+			}
+			}
+		}
+		return true;
+	}
+
+private:
+	static int translateKey(KeySym key)
+	{
+		if (key >= XK_a && key <= XK_z) return 'A' + (int)(key - XK_a);
+		if (key >= XK_0 && key <= XK_9) return '0' + (int)(key - XK_0);
+		switch (key)
+		{
+		case XK_BackSpace: return KEY_BACKSPACE;
+		case XK_Tab: return KEY_TAB;
+		case XK_Return: return KEY_ENTER;
+		case XK_Escape: return KEY_ESCAPE;
+		case XK_space: return KEY_SPACE;
+		case XK_Left: return KEY_LEFT;
+		case XK_Up: return KEY_UP;
+		case XK_Right: return KEY_RIGHT;
+		case XK_Down: return KEY_DOWN;
+		}
+		return 0;
+	}
+
+};
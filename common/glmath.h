@@ -1,88 +1,345 @@
 #pragma once
 
 #include <math.h>
+#include <string.h>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define GLMATH_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GLMATH_NEON
+#endif
+
 const auto PI = 3.1415926f;
 
-float sinDeg(float angle)
+// Implementation behind sinDeg/cosDeg, picked at compile time by defining
+// GLMATH_TRIG before including this header. Max absolute error against double
+// precision sin of the same float angle, for angles within +-180 and +-720:
+//   GLMATH_TRIG_LIBM   sinf/cosf of the angle in radians (default)  4.4e-7  1.7e-6
+//   GLMATH_TRIG_TABLE  4096-entry table, linear interpolation       3.8e-7  7.7e-7
+//   GLMATH_TRIG_POLY   degree 7 minimax polynomial                  7.2e-7  7.2e-7
+// Throughput against glibc's sinf ("Benchmarks trig", x86-64, g++ -O2) hinges
+// on floorf: with SSE4.1 it is one instruction and table runs 1.9x, poly
+// 1.3x; on plain SSE2 it is a call and table runs 1.2x, poly 0.8x.
+#define GLMATH_TRIG_LIBM 0
+#define GLMATH_TRIG_TABLE 1
+#define GLMATH_TRIG_POLY 2
+#ifndef GLMATH_TRIG
+#define GLMATH_TRIG GLMATH_TRIG_LIBM
+#endif
+
+class FastTrig
+{
+public:
+	static const int TABLE_SIZE = 4096;
+
+	// angle in degrees, any range
+	static float tableSin(float angle)
+	{
+		static const auto table = buildTable();
+		auto t = angle * (TABLE_SIZE / 360.0f);
+		auto i = floorf(t);
+		auto frac = t - i;
+		auto index = (int)((long long)i & (TABLE_SIZE - 1));
+		return table[index] + (table[index + 1] - table[index]) * frac;
+	}
+
+	// angle in degrees, any range
+	static float polySin(float angle)
+	{
+		// Reduce to [-180, 180], then fold onto [-90, 90] where sin is odd and monotonic.
+		auto a = angle - 360.0f * floorf(angle / 360.0f + 0.5f);
+		if (a > 90.0f) a = 180.0f - a;
+		else if (a < -90.0f) a = -180.0f - a;
+
+		// Remez coefficients for sin(x) on [-pi/2, pi/2], max error 5.9e-7.
+		const auto x = a * (PI / 180.0f);
+		const auto x2 = x * x;
+		return x * (0.99999661f + x2 * (-0.16664828f + x2 * (0.0083063252f + x2 * -0.00018363654f)));
+	}
+
+private:
+	struct Table { float v[TABLE_SIZE + 1]; float operator [] (int i) const { return v[i]; } };
+
+	static Table buildTable()
+	{
+		Table table;
+		for (auto i = 0; i <= TABLE_SIZE; ++i)
+			table.v[i] = (float)sin(i * 2.0 * 3.14159265358979323846 / TABLE_SIZE);
+		return table;
+	}
+};
+
+inline float sinDeg(float angle)
 {
+#if GLMATH_TRIG == GLMATH_TRIG_TABLE
+	return FastTrig::tableSin(angle);
+#elif GLMATH_TRIG == GLMATH_TRIG_POLY
+	return FastTrig::polySin(angle);
+#else
 	return sinf(angle * PI / 180.0f);
+#endif
 }
 
-float cosDeg(float angle)
+inline float cosDeg(float angle)
 {
+#if GLMATH_TRIG == GLMATH_TRIG_TABLE
+	return FastTrig::tableSin(angle + 90.0f);
+#elif GLMATH_TRIG == GLMATH_TRIG_POLY
+	return FastTrig::polySin(angle + 90.0f);
+#else
 	return cosf(angle * PI / 180.0f);
+#endif
 }
 
+// 4-wide float operations behind one interface (SSE, NEON or plain floats),
+// so the matrix kernels below are written once for every target.
+// "Benchmarks matrix" times them against the scalar loops.
+class Simd
+{
+public:
+#if defined(GLMATH_SSE)
+	typedef __m128 Float4;
+	static Float4 load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, Float4 a) { _mm_storeu_ps(p, a); }
+	static Float4 splat(float s) { return _mm_set1_ps(s); }
+	static Float4 mul(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+	static Float4 madd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#elif defined(GLMATH_NEON)
+	typedef float32x4_t Float4;
+	static Float4 load(const float* p) { return vld1q_f32(p); }
+	static void store(float* p, Float4 a) { vst1q_f32(p, a); }
+	static Float4 splat(float s) { return vdupq_n_f32(s); }
+	static Float4 mul(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+	static Float4 madd(Float4 a, Float4 b, Float4 c) { return vmlaq_f32(c, a, b); }
+#else
+	struct Float4 { float v[4]; };
+	static Float4 load(const float* p) { Float4 r; for (auto i = 0; i < 4; ++i) r.v[i] = p[i]; return r; }
+	static void store(float* p, const Float4& a) { for (auto i = 0; i < 4; ++i) p[i] = a.v[i]; }
+	static Float4 splat(float s) { Float4 r; for (auto i = 0; i < 4; ++i) r.v[i] = s; return r; }
+	static Float4 mul(const Float4& a, const Float4& b) { Float4 r; for (auto i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i]; return r; }
+	static Float4 madd(const Float4& a, const Float4& b, const Float4& c) { Float4 r; for (auto i = 0; i < 4; ++i) r.v[i] = a.v[i] * b.v[i] + c.v[i]; return r; }
+#endif
+
+	// out = a * b for column-major 4x4 matrices. out may alias a or b:
+	// every column of a is loaded up front and each column of b is read before
+	// the matching column of out is written.
+	static void multiplyMatrix(const float* a, const float* b, float* out)
+	{
+		multiplyMatrices(a, b, out, 1);
+	}
+
+	// out[i] = a * b[i] for count consecutive matrices in b and out. The columns
+	// of a stay in registers for the whole run.
+	static void multiplyMatrices(const float* a, const float* b, float* out, int count)
+	{
+#if defined(__AVX__)
+		// Two result columns per iteration, one per 128-bit lane.
+		const auto a0 = _mm256_broadcast_ps((const __m128*)(a + 0));
+		const auto a1 = _mm256_broadcast_ps((const __m128*)(a + 4));
+		const auto a2 = _mm256_broadcast_ps((const __m128*)(a + 8));
+		const auto a3 = _mm256_broadcast_ps((const __m128*)(a + 12));
+		for (auto i = 0; i < count * 16; i += 8)
+		{
+			const auto bc = _mm256_loadu_ps(b + i);
+			auto r = _mm256_mul_ps(a0, _mm256_permute_ps(bc, 0x00));
+			r = _mm256_add_ps(_mm256_mul_ps(a1, _mm256_permute_ps(bc, 0x55)), r);
+			r = _mm256_add_ps(_mm256_mul_ps(a2, _mm256_permute_ps(bc, 0xAA)), r);
+			r = _mm256_add_ps(_mm256_mul_ps(a3, _mm256_permute_ps(bc, 0xFF)), r);
+			_mm256_storeu_ps(out + i, r);
+		}
+#else
+		const auto a0 = load(a + 0);
+		const auto a1 = load(a + 4);
+		const auto a2 = load(a + 8);
+		const auto a3 = load(a + 12);
+		for (auto i = 0; i < count * 16; i += 4)
+		{
+			const auto bc = b + i;
+			auto r = mul(a0, splat(bc[0]));
+			r = madd(a1, splat(bc[1]), r);
+			r = madd(a2, splat(bc[2]), r);
+			r = madd(a3, splat(bc[3]), r);
+			store(out + i, r);
+		}
+#endif
+	}
+
+	// out = a * v for a column-major 4x4 matrix. out may alias v.
+	static void multiplyVector(const float* a, const float* v, float* out)
+	{
+		auto r = mul(load(a + 0), splat(v[0]));
+		r = madd(load(a + 4), splat(v[1]), r);
+		r = madd(load(a + 8), splat(v[2]), r);
+		r = madd(load(a + 12), splat(v[3]), r);
+		store(out, r);
+	}
+};
+
 class Vector
 {
 private:
-	float v[4];
+	alignas(16) float v[4];
 public:
-	Vector(float x, float y, float z, float w)
+	constexpr Vector(float x, float y, float z, float w) : v{ x, y, z, w } { }
+	constexpr Vector(const float* p) : v{ p[0], p[1], p[2], p[3] } { }
+	constexpr float x() const { return v[0]; }
+	constexpr float y() const { return v[1]; }
+	constexpr float z() const { return v[2]; }
+	constexpr float w() const { return v[3]; }
+	constexpr const float* data() const { return v; }
+};
+
+// Orientation as a unit quaternion (x, y, z, w). Products compose like Matrix:
+// a * b rotates by b first, then by a. Composing two of them is 16 multiplies,
+// and normalized() keeps accumulated orientations from drifting.
+class Quaternion
+{
+private:
+	float q[4];
+public:
+	constexpr Quaternion(float x, float y, float z, float w) : q{ x, y, z, w } { }
+	constexpr float x() const { return q[0]; }
+	constexpr float y() const { return q[1]; }
+	constexpr float z() const { return q[2]; }
+	constexpr float w() const { return q[3]; }
+
+	static constexpr Quaternion identity()
+	{
+		return Quaternion(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	// CCW, same convention as Matrix::rotation
+	static Quaternion rotation(float angle, float x, float y, float z)
 	{
-		v[0] = x; v[1] = y; v[2] = z; v[3] = w;
+		const auto mag = sqrtf(x * x + y * y + z * z);
+		if (mag > 0.0f)
+		{
+			const auto s = sinDeg(angle / 2.0f) / mag;
+			return Quaternion(x * s, y * s, z * s, cosDeg(angle / 2.0f));
+		}
+		else
+		{
+			return Quaternion::identity();
+		}
 	}
-	Vector(const float* p)
+
+	constexpr Quaternion operator * (const Quaternion& o) const
+	{
+		return Quaternion(
+			q[3] * o.q[0] + q[0] * o.q[3] + q[1] * o.q[2] - q[2] * o.q[1],
+			q[3] * o.q[1] - q[0] * o.q[2] + q[1] * o.q[3] + q[2] * o.q[0],
+			q[3] * o.q[2] + q[0] * o.q[1] - q[1] * o.q[0] + q[2] * o.q[3],
+			q[3] * o.q[3] - q[0] * o.q[0] - q[1] * o.q[1] - q[2] * o.q[2]);
+	}
+
+	constexpr float dot(const Quaternion& o) const
 	{
-		for (auto i = 0; i < 4; ++i) v[i] = p[i];
+		return q[0] * o.q[0] + q[1] * o.q[1] + q[2] * o.q[2] + q[3] * o.q[3];
+	}
+
+	Quaternion normalized() const
+	{
+		const auto mag = sqrtf(dot(*this));
+		if (mag > 0.0f)
+		{
+			const auto inv = 1.0f / mag;
+			return Quaternion(q[0] * inv, q[1] * inv, q[2] * inv, q[3] * inv);
+		}
+		else
+		{
+			return Quaternion::identity();
+		}
+	}
+
+	// Shortest-arc interpolation from a (t = 0) to b (t = 1).
+	static Quaternion slerp(const Quaternion& a, const Quaternion& b, float t)
+	{
+		auto cosTheta = a.dot(b);
+		auto sign = 1.0f;
+		if (cosTheta < 0.0f)
+		{
+			cosTheta = -cosTheta;
+			sign = -1.0f;
+		}
+
+		auto wa = 1.0f - t;
+		auto wb = t;
+		// Nearly parallel: sin(theta) vanishes, so fall back to a normalized lerp.
+		if (cosTheta < 0.9995f)
+		{
+			const auto theta = acosf(cosTheta);
+			const auto invSin = 1.0f / sinf(theta);
+			wa = sinf((1.0f - t) * theta) * invSin;
+			wb = sinf(t * theta) * invSin;
+		}
+		wb *= sign;
+
+		return Quaternion(
+			wa * a.q[0] + wb * b.q[0],
+			wa * a.q[1] + wb * b.q[1],
+			wa * a.q[2] + wb * b.q[2],
+			wa * a.q[3] + wb * b.q[3]).normalized();
 	}
-	float x() const { return v[0]; }
-	float y() const { return v[1]; }
-	float z() const { return v[2]; }
-	float w() const { return v[3]; }
-	const float* data() const { return v; }
 };
 
 class Matrix
 {
 private:
-	float m[16];
+	alignas(16) float m[16];
 
-	Matrix()
-	{
-		for (auto i = 0; i < 16; ++i) m[i] = 0.0f;
-	}
+	constexpr Matrix() : m{} { }
 
-	Matrix(const float* p)
+	// p is row-major, as the factories below are written.
+	constexpr Matrix(const float* p) : m{}
 	{
 		for (auto i = 0; i < 4; ++i)
 			for (auto j = 0; j < 4; ++j)
 				m[i * 4 + j] = p[j * 4 + i];
 	}
 
-	float get(int row, int col) const { return m[col * 4 + row]; }
-	void set(int row, int col, float value) { m[col * 4 + row] = value; }
+	constexpr float get(int row, int col) const { return m[col * 4 + row]; }
+	constexpr void set(int row, int col, float value) { m[col * 4 + row] = value; }
 
 public:
-	const float* data() const { return m; }
+	constexpr const float* data() const { return m; }
+	constexpr float at(int row, int col) const { return get(row, col); }
+
+	Matrix operator * (const Matrix& other) const
+	{
+		auto result = Matrix();
+		Simd::multiplyMatrix(m, other.m, result.m);
+		return result;
+	}
 
-	Matrix operator * (const Matrix& other)
+	Vector operator * (const Vector& vector) const
 	{
-		auto result = Matrix();		
+		alignas(16) float result[4];
+		Simd::multiplyVector(m, vector.data(), result);
+		return Vector(result);
+	}
+
+	// Scalar a * b usable in constant expressions; operator * is the runtime path.
+	static constexpr Matrix multiply(const Matrix& a, const Matrix& b)
+	{
+		auto result = Matrix();
 		for (auto row = 0; row < 4; ++row)
 			for (auto col = 0; col < 4; ++col)
 			{
 				auto sum = 0.0f;
-				for (auto k = 0; k < 4; ++k) sum += this->get(row, k) * other.get(k, col);
+				for (auto k = 0; k < 4; ++k) sum += a.get(row, k) * b.get(k, col);
 				result.set(row, col, sum);
 			}
 		return result;
 	}
 
-	Vector operator * (const Vector& vector)
-	{
-		float result[4];
-		auto v = vector.data();
-		for (auto row = 0; row < 4; ++row)
-		{
-			auto sum = 0.0f;
-			for (int k = 0; k < 4; ++k) sum += this->get(row, k) * v[k];
-			result[row] = sum;
-		}
-		return Vector(result);
-	}
-
-	static Matrix identity()
+	static constexpr Matrix identity()
 	{
 		auto a = Matrix();
 		for (auto row = 0; row < 4; ++row)
@@ -94,7 +351,7 @@ public:
 		return a;
 	}
 
-	static Matrix translate(float a, float b, float c)
+	static constexpr Matrix translate(float a, float b, float c)
 	{
 		float p[] =
 		{
@@ -106,7 +363,7 @@ public:
 		return Matrix(p);
 	}
 
-	static Matrix scale(float a, float b, float c)
+	static constexpr Matrix scale(float a, float b, float c)
 	{
 		float p[] =
 		{
@@ -157,7 +414,21 @@ public:
 		}
 	}
 
-	static Matrix frustum(float l, float r, float b, float t, float n, float f)
+	// q must be a unit quaternion
+	static constexpr Matrix rotation(const Quaternion& q)
+	{
+		const auto x = q.x(), y = q.y(), z = q.z(), w = q.w();
+		const float p[] =
+		{
+			1.0f - 2.0f * (y * y + z * z),        2.0f * (x * y - z * w),        2.0f * (x * z + y * w), 0.0f,
+			       2.0f * (x * y + z * w), 1.0f - 2.0f * (x * x + z * z),        2.0f * (y * z - x * w), 0.0f,
+			       2.0f * (x * z - y * w),        2.0f * (y * z + x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f,
+			                         0.0f,                          0.0f,                          0.0f, 1.0f
+		};
+		return Matrix(p);
+	}
+
+	static constexpr Matrix frustum(float l, float r, float b, float t, float n, float f)
 	{
 		float p[] =
 		{
@@ -169,7 +440,7 @@ public:
 		return Matrix(p);
 	}
 
-	static Matrix ortho(float l, float r, float b, float t, float n, float f)
+	static constexpr Matrix ortho(float l, float r, float b, float t, float n, float f)
 	{
 		float p[] =
 		{
@@ -189,3 +460,58 @@ public:
 	}
 
 };
+
+// Compile-time checks of the constexpr factories; a failure here stops the build.
+static_assert(Matrix::identity().at(0, 0) == 1.0f && Matrix::identity().at(3, 3) == 1.0f && Matrix::identity().at(0, 1) == 0.0f, "identity");
+static_assert(Matrix::translate(1.0f, 2.0f, 3.0f).data()[12] == 1.0f && Matrix::translate(1.0f, 2.0f, 3.0f).data()[14] == 3.0f, "translate is column-major");
+static_assert(Matrix::scale(2.0f, 3.0f, 4.0f).at(1, 1) == 3.0f && Matrix::scale(2.0f, 3.0f, 4.0f).at(3, 3) == 1.0f, "scale");
+static_assert(Matrix::multiply(Matrix::translate(1.0f, 2.0f, 3.0f), Matrix::translate(4.0f, 5.0f, 6.0f)).at(1, 3) == 7.0f, "translations compose");
+static_assert(Matrix::multiply(Matrix::scale(2.0f, 2.0f, 2.0f), Matrix::translate(1.0f, 0.0f, 0.0f)).at(0, 3) == 2.0f, "scale applies after translate");
+static_assert(Matrix::frustum(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f).at(2, 2) == -2.0f && Matrix::frustum(-1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 3.0f).at(3, 2) == -1.0f, "frustum");
+static_assert(Matrix::ortho(-2.0f, 2.0f, -1.0f, 1.0f, 0.0f, 2.0f).at(0, 0) == 0.5f && Matrix::ortho(-2.0f, 2.0f, -1.0f, 1.0f, 0.0f, 2.0f).at(2, 3) == -1.0f, "ortho");
+static_assert(Vector(1.0f, 2.0f, 3.0f, 4.0f).z() == 3.0f, "vector");
+
+// N model matrices and their products with a shared view-projection, in two
+// contiguous arrays of whole column-major matrices. That is array of structs
+// at the matrix level, on purpose: data() must be what glUniformMatrix4fv(
+// location, size(), GL_FALSE, data()) and buffer uploads take, and the 4-wide
+// kernel already fills its lanes from the four rows of one column, so a
+// structure of arrays layout would only add a transpose before every upload.
+// What the batch saves is the per-object call overhead: transform() keeps the
+// view-projection in registers over all N products in one pass.
+class TransformBatch
+{
+private:
+	std::vector<float> m_models;
+	std::vector<float> m_results;
+
+public:
+	TransformBatch(int count = 0)
+	{
+		resize(count);
+	}
+
+	void resize(int count)
+	{
+		m_models.resize(count * 16);
+		m_results.resize(count * 16);
+	}
+
+	int size() const { return (int)m_models.size() / 16; }
+
+	void setModel(int index, const Matrix& model)
+	{
+		memcpy(&m_models[index * 16], model.data(), 16 * sizeof(float));
+	}
+
+	// Column-major model matrices, 16 floats each, for callers that generate
+	// them in place.
+	float* models() { return m_models.data(); }
+
+	void transform(const Matrix& viewProjection)
+	{
+		Simd::multiplyMatrices(viewProjection.data(), m_models.data(), m_results.data(), size());
+	}
+
+	const float* data() const { return m_results.data(); }
+};